@@ -11,5 +11,8 @@ public class MovementDemoTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.Latest;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Latest;
 		ExtraModuleNames.Add("MovementDemo");
+
+		// Iris is compiled in, but only used if enabled with net.Iris.UseIrisReplication=1 or -UseIrisReplication=1
+		bUseIris = true;
 	}
 }
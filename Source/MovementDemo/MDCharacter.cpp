@@ -4,12 +4,11 @@
 #include "MovementDemo/MDCharacter.h"
 #include "MovementDemo/MDCharacterMovementComponent.h"
 #include "MovementDemo/MDCheckpointTrackerComponent.h"
-#include "MovementDemo/MDPlayerNameWidget.h"
+#include "MovementDemo/MDSkeletalMeshComponent.h"
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
-#include "Components/WidgetComponent.h"
 #include "GameFramework/PlayerState.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
@@ -18,23 +17,14 @@
 
 
 AMDCharacter::AMDCharacter(const FObjectInitializer& ObjectInitializer) :
-Super(ObjectInitializer.SetDefaultSubobjectClass<UMDCharacterMovementComponent>(CharacterMovementComponentName))
+Super(ObjectInitializer.SetDefaultSubobjectClass<UMDCharacterMovementComponent>(CharacterMovementComponentName).SetDefaultSubobjectClass<UMDSkeletalMeshComponent>(MeshComponentName))
 {
 	PrimaryActorTick.bCanEverTick = false;
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationYaw = false;
 	bUseControllerRotationRoll = false;
 	NetUpdateFrequency = 30.0f;
-
-	SpringArmComp = CreateDefaultSubobject<USpringArmComponent>("SpringArmComp");
-	SpringArmComp->SetupAttachment(GetRootComponent());
-	SpringArmComp->TargetArmLength = 350.0f;
-	SpringArmComp->bUsePawnControlRotation = true;
-
-	CameraComp = CreateDefaultSubobject<UCameraComponent>("CameraComp");
-	CameraComp->SetupAttachment(SpringArmComp, USpringArmComponent::SocketName);
-	CameraComp->bUsePawnControlRotation = false;
-	CameraComp->FieldOfView = 100.0f;
+	NetUpdatePolicyClass = UMDCharacterNetUpdatePolicy::StaticClass();
 
 	GetMesh()->SetCollisionResponseToChannel(ECC_Camera, ECR_Ignore);
 
@@ -42,10 +32,17 @@ Super(ObjectInitializer.SetDefaultSubobjectClass<UMDCharacterMovementComponent>(
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);
 
 	CheckpointTrackerComp = CreateDefaultSubobject<UMDCheckpointTrackerComponent>("CheckpointTrackerComponent");
+}
 
-	NameWidgetComp = CreateDefaultSubobject<UWidgetComponent>("NameWidgetComponent");
-	NameWidgetComp->SetupAttachment(GetMesh());
-	NameWidgetComp->SetRelativeLocation(FVector(0.0, 0.0, 200.0));
+void AMDCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Nothing renders the mesh on dedicated server. Montages still tick, but the anim graph and Control Rig are not evaluated.
+	if(IsNetMode(NM_DedicatedServer))
+	{
+		GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+	}
 }
 
 void AMDCharacter::PawnClientRestart()
@@ -66,8 +63,7 @@ void AMDCharacter::PawnClientRestart()
 			}
 		}
 
-		// Hide our own name widget comp
-		NameWidgetComp->SetHiddenInGame(true, true);
+		CreateCameraRig();
 	}
 }
 
@@ -75,12 +71,6 @@ void AMDCharacter::PossessedBy(AController* NewController)
 {
 	// We are not going to call for ACharacter method, so we have smoother animations on listen server
 	APawn::PossessedBy(NewController);
-
-	// We need to update the name on server (OnRep is not called)
-	if(auto* PS = GetPlayerState())
-	{
-		SetNameWidgetText(PS->GetPlayerName());
-	}
 }
 
 void AMDCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -146,11 +136,8 @@ void AMDCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLife
 	FDoRepLifetimeParams Params;
 	Params.bIsPushBased = true;
 	Params.Condition = COND_SkipOwner;
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, bIsSliding, Params);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, bIsMantling, Params);
-
-	// This updates every Replication
-	DOREPLIFETIME_CONDITION(ThisClass, RemoteViewYaw, COND_SkipOwner);
+	// View yaw is set every replication in PreReplication, but this is only marked dirty when some packed value changes
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ProxyState, Params);
 }
 
 void AMDCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
@@ -161,6 +148,11 @@ void AMDCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTra
 	{
 		SetRemoteViewYaw(GetController()->GetControlRotation().Yaw);
 	}
+
+	if (NetUpdateState != EMDNetUpdateState::Count)
+	{
+		UMDCharacterNetUpdatePolicy::RecordNetUpdate(NetUpdateState);
+	}
 }
 
 void AMDCharacter::PreReplicationForReplay(IRepChangedPropertyTracker& ChangedPropertyTracker)
@@ -178,12 +170,6 @@ void AMDCharacter::PreReplicationForReplay(IRepChangedPropertyTracker& ChangedPr
 	}
 }
 
-void AMDCharacter::OnRep_PlayerState()
-{
-	Super::OnRep_PlayerState();
-	SetNameWidgetText(GetPlayerState()->GetPlayerName());
-}
-
 FRotator AMDCharacter::GetBaseAimRotation() const
 {
 	// If we have a controller, by default we aim at the player's 'eyes' direction
@@ -202,7 +188,7 @@ FRotator AMDCharacter::GetBaseAimRotation() const
 	if (GetLocalRole() == ROLE_SimulatedProxy)
 	{
 		POVRot.Pitch = FRotator::DecompressAxisFromByte(RemoteViewPitch);
-		POVRot.Yaw = FRotator::DecompressAxisFromByte(RemoteViewYaw);
+		POVRot.Yaw = FRotator::DecompressAxisFromByte(ProxyState.ViewYaw);
 	}
 
 	return POVRot;
@@ -230,20 +216,40 @@ void AMDCharacter::Jump()
 	}
 }
 
-void AMDCharacter::SetNameWidgetText(const FString& NewName)
+void AMDCharacter::UpdateNetUpdateState()
 {
-	// Need to make sure it's in proper state.
-	NameWidgetComp->InitWidget();
-	if (auto* Widget = Cast<UMDPlayerNameWidget>(NameWidgetComp->GetUserWidgetObject()))
+	if(!HasAuthority() || !NetUpdatePolicyClass)
+	{
+		return;
+	}
+
+	const auto* Policy = NetUpdatePolicyClass->GetDefaultObject<UMDCharacterNetUpdatePolicy>();
+	const EMDNetUpdateState NewState = Policy->GetStateFor(*this);
+	if(NewState == NetUpdateState)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if(NetUpdateState != EMDNetUpdateState::Count)
 	{
-		Widget->SetNameText(NewName);
+		UMDCharacterNetUpdatePolicy::RecordTimeInState(NetUpdateState, Now - NetUpdateStateStartTime);
 	}
+	NetUpdateState = NewState;
+	NetUpdateStateStartTime = Now;
+
+	Policy->ApplyState(*this, NewState);
 }
 
 void AMDCharacter::SetRemoteViewYaw(float NewRemoteViewYaw)
 {
 	// Compress yaw to 1 byte
-	RemoteViewYaw = FRotator::CompressAxisToByte(NewRemoteViewYaw);
+	const uint8 CompressedYaw = FRotator::CompressAxisToByte(NewRemoteViewYaw);
+	if(ProxyState.ViewYaw != CompressedYaw)
+	{
+		ProxyState.ViewYaw = CompressedYaw;
+		MarkProxyStateDirty();
+	}
 }
 
 void AMDCharacter::SetIsSliding(bool bSlide)
@@ -251,10 +257,10 @@ void AMDCharacter::SetIsSliding(bool bSlide)
 	// Simulated should never call this...
 	check(GetLocalRole() != ROLE_SimulatedProxy);
 
-	bIsSliding = bSlide;
-	if(HasAuthority())
+	if(ProxyState.bIsSliding != bSlide)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, bIsSliding, this);
+		ProxyState.bIsSliding = bSlide;
+		MarkProxyStateDirty();
 	}
 }
 
@@ -262,13 +268,30 @@ void AMDCharacter::SetIsMantling(bool bMantle)
 {
 	// Simulated should never call this...
 	check(GetLocalRole() != ROLE_SimulatedProxy);
-	bIsMantling = bMantle;
+	if(ProxyState.bIsMantling != bMantle)
+	{
+		ProxyState.bIsMantling = bMantle;
+		MarkProxyStateDirty();
+	}
+	// Call manually on local player and server, simulated proxies call it from replication
+	OnIsMantlingChanged();
+}
+
+void AMDCharacter::SetWallRunSide(EMDWallRunSide NewSide)
+{
+	if(ProxyState.WallRunSide != NewSide)
+	{
+		ProxyState.WallRunSide = NewSide;
+		MarkProxyStateDirty();
+	}
+}
+
+void AMDCharacter::MarkProxyStateDirty()
+{
 	if(HasAuthority())
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, bIsMantling, this);
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ProxyState, this);
 	}
-	// Call OnRep manually on local player and server, simulated proxies call it from replication
-	OnRep_IsMantling();
 }
 
 void AMDCharacter::ServerDoMantleRPC_Implementation()
@@ -282,10 +305,73 @@ void AMDCharacter::ServerDoMantleRPC_Implementation()
 	}
 }
 
+void AMDCharacter::ClientSetCheckpointIndex_Implementation(uint16 EncodedIndex, float ServerMoveTimeStamp)
+{
+	CheckpointTrackerComp->SetCurrentCheckpointIndexFromServer(static_cast<int32>(EncodedIndex) - 1, ServerMoveTimeStamp);
+}
+
 void AMDCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Not created on dedicated server
+	if(auto* SignificanceSubsystem = GetWorld()->GetSubsystem<UMDSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterRacer(*this);
+	}
+}
+
+void AMDCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(auto* SignificanceSubsystem = GetWorld()->GetSubsystem<UMDSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterRacer(*this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMDCharacter::ApplySignificance(EMDSignificanceLevel NewLevel, const FMDSignificanceSettings& Settings, bool bApplyAnimTickSettings)
+{
+	SignificanceLevel = NewLevel;
+
+	GetCharacterMovement()->NetworkSmoothingMode = Settings.NetworkSmoothingMode;
+	// Movement of pawns we simulate ourselves must keep ticking, only proxies can skip frames
+	if(GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		GetCharacterMovement()->SetComponentTickInterval(Settings.MovementTickInterval);
+	}
+
+	if(bApplyAnimTickSettings)
+	{
+		GetMesh()->VisibilityBasedAnimTickOption = Settings.AnimTickOption;
+		GetMesh()->SetComponentTickInterval(Settings.AnimTickInterval);
+	}
+}
+
+void AMDCharacter::CreateCameraRig()
+{
+	if(SpringArmComp)
+	{
+		return;
+	}
+
+	// Only the local view needs the spring arm collision probe
+	SpringArmComp = NewObject<USpringArmComponent>(this, "SpringArmComp");
+	SpringArmComp->SetupAttachment(GetRootComponent());
+	SpringArmComp->TargetArmLength = CameraArmLength;
+	SpringArmComp->bUsePawnControlRotation = true;
+	SpringArmComp->SocketOffset = CameraSocketOffset;
+	SpringArmComp->bEnableCameraLag = bEnableCameraLag;
+	SpringArmComp->CameraLagSpeed = CameraLagSpeed;
+	SpringArmComp->CameraLagMaxDistance = CameraLagMaxDistance;
+	SpringArmComp->RegisterComponent();
+
+	CameraComp = NewObject<UCameraComponent>(this, "CameraComp");
+	CameraComp->SetupAttachment(SpringArmComp, USpringArmComponent::SocketName);
+	CameraComp->bUsePawnControlRotation = false;
+	CameraComp->FieldOfView = CameraFieldOfView;
+	CameraComp->RegisterComponent();
 }
 
 void AMDCharacter::MoveForward(const FInputActionValue& Value, float Direction)
@@ -362,9 +448,17 @@ void AMDCharacter::Slide_Released()
 	CastChecked<UMDCharacterMovementComponent>(GetCharacterMovement())->SetWantsToSlide(false);
 }
 
-void AMDCharacter::OnRep_IsMantling()
+void AMDCharacter::OnRep_ProxyState(const FMDProxyState& OldProxyState)
+{
+	if(OldProxyState.bIsMantling != ProxyState.bIsMantling)
+	{
+		OnIsMantlingChanged();
+	}
+}
+
+void AMDCharacter::OnIsMantlingChanged()
 {
-	if(bIsMantling && Montage_Mantle)
+	if(ProxyState.bIsMantling && Montage_Mantle)
 	{
 		PlayAnimMontage(Montage_Mantle);
 	}
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "MovementDemo/MDCharacterNetUpdatePolicy.h"
+#include "MovementDemo/MDProxyState.h"
+#include "MovementDemo/MDSignificanceSubsystem.h"
 #include "MDCharacter.generated.h"
 
 class USpringArmComponent;
@@ -12,13 +15,16 @@ class UMDCheckpointTrackerComponent;
 class UInputMappingContext;
 class UInputAction;
 class UAnimMontage;
-class UWidgetComponent;
 struct FInputActionValue;
 
 /**
  * MDCharacter is playable character that has functionality for sliding, wall running and mantling.
  * All movements are fully networked, client predicted and server authoritative.
  * Replication rates, send rates etc are limited to 30hz. See DefaultGame.ini and DefaultEngine.ini.
+ * Server lowers net update frequency below that based on movement state, see UMDCharacterNetUpdatePolicy.
+ * Camera and spring arm are created only for locally controlled pawn. Dedicated server doesn't evaluate the anim graph.
+ * Names on top of players are drawn by AMDHUD, characters have no widgets.
+ * On clients, smoothing and animation of each racer follow its significance, see UMDSignificanceSubsystem.
  */
 UCLASS()
 class MOVEMENTDEMO_API AMDCharacter : public ACharacter
@@ -29,6 +35,8 @@ public:
 
 	AMDCharacter(const FObjectInitializer& ObjectInitializer);
 
+	virtual void PostInitializeComponents() override;
+
 	virtual void PawnClientRestart() override;
 
 	virtual void PossessedBy(AController* NewController) override;
@@ -41,42 +49,74 @@ public:
 
 	virtual void PreReplicationForReplay(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
-	virtual void OnRep_PlayerState() override;
-
 	virtual FRotator GetBaseAimRotation() const override;
 
 	virtual void Jump() override;
 
-	void SetNameWidgetText(const FString& NewName);
-
 	void SetRemoteViewYaw(float NewRemoteViewYaw);
 
 	void SetIsSliding(bool bSlide);
 
-	bool IsSliding() const { return bIsSliding; }
+	bool IsSliding() const { return ProxyState.bIsSliding; }
 
 	void SetIsMantling(bool bMantle);
 
-	bool IsMantling() const { return bIsMantling; }
+	bool IsMantling() const { return ProxyState.bIsMantling; }
+
+	void SetWallRunSide(EMDWallRunSide NewSide);
+
+	EMDWallRunSide GetWallRunSide() const { return ProxyState.WallRunSide; }
 
 	UFUNCTION(Server, Reliable)
 	void ServerDoMantleRPC();
 
 	UMDCheckpointTrackerComponent* GetCheckpointTrackerComp() const { return CheckpointTrackerComp; }
 
+	// Checkpoint tracker is not replicated, owning client gets checkpoint changes trough this.
+	// Index into MDCheckpointSubsystem route plus one, 0 means no checkpoint. Avoids sending actor references.
+	// ServerMoveTimeStamp is the client move that server was processing, so client knows which of its predictions this answers.
+	UFUNCTION(Client, Reliable)
+	void ClientSetCheckpointIndex(uint16 EncodedIndex, float ServerMoveTimeStamp);
+
+	// Server only. Called after each move, applies net update settings if movement state changed.
+	void UpdateNetUpdateState();
+
+	EMDSignificanceLevel GetSignificanceLevel() const { return SignificanceLevel; }
+
+	// Called by UMDSignificanceSubsystem when the level changes. Anim tick settings are skipped when animation budget allocator controls the mesh.
+	void ApplySignificance(EMDSignificanceLevel NewLevel, const FMDSignificanceSettings& Settings, bool bApplyAnimTickSettings);
+
 protected:
 
-	UPROPERTY(VisibleAnywhere)
+	// Only for locally controlled pawn, see CreateCameraRig
+	UPROPERTY(VisibleInstanceOnly, Transient)
 	USpringArmComponent* SpringArmComp;
 
-	UPROPERTY(VisibleAnywhere)
+	// Only for locally controlled pawn, see CreateCameraRig
+	UPROPERTY(VisibleInstanceOnly, Transient)
 	UCameraComponent* CameraComp;
 
 	UPROPERTY(VisibleAnywhere)
 	UMDCheckpointTrackerComponent* CheckpointTrackerComp;
 
-	UPROPERTY(VisibleAnywhere)
-	UWidgetComponent* NameWidgetComp;
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera")
+	float CameraArmLength = 350.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera")
+	float CameraFieldOfView = 100.0f;
+
+	// Camera rig values that used to be set on the spring arm template in BP_PlayerCharacter
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera")
+	FVector CameraSocketOffset = FVector(0.0, 0.0, 60.0);
+
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera")
+	bool bEnableCameraLag = true;
+
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera", meta = (EditCondition = "bEnableCameraLag"))
+	float CameraLagSpeed = 30.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Camera", meta = (EditCondition = "bEnableCameraLag"))
+	float CameraLagMaxDistance = 100.0f;
 
 	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Input")
 	UInputMappingContext* InputMappingContext;
@@ -84,14 +124,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Mantle")
 	UAnimMontage* Montage_Mantle;
 
-	UPROPERTY(Replicated)
-	uint32 bIsSliding:1;
+	UPROPERTY(EditDefaultsOnly, Category = "MovementDemo|Network")
+	TSubclassOf<UMDCharacterNetUpdatePolicy> NetUpdatePolicyClass;
+
+	EMDNetUpdateState NetUpdateState = EMDNetUpdateState::Count;
 
-	UPROPERTY(ReplicatedUsing = OnRep_IsMantling)
-	uint32 bIsMantling:1;
+	double NetUpdateStateStartTime = 0.0;
 
-	UPROPERTY(Replicated)
-	uint8 RemoteViewYaw;
+	EMDSignificanceLevel SignificanceLevel = EMDSignificanceLevel::High;
+
+	// Sliding, mantling, wall run side and view yaw for simulated proxies
+	UPROPERTY(ReplicatedUsing = OnRep_ProxyState)
+	FMDProxyState ProxyState;
 
 	/*
 	 * These could live in a config (UDataAsset) class, but since we won't have too many for the demo, just put them here.
@@ -131,6 +175,11 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Spring arm and camera for local view. Created when the pawn is restarted for local controller.
+	void CreateCameraRig();
+
 	void MoveForward(const FInputActionValue& Value, float Direction);
 
 	void MoveRight(const FInputActionValue& Value, float Direction);
@@ -156,5 +205,9 @@ protected:
 	void Slide_Released();
 
 	UFUNCTION()
-	void OnRep_IsMantling();
+	void OnRep_ProxyState(const FMDProxyState& OldProxyState);
+
+	void OnIsMantlingChanged();
+
+	void MarkProxyStateDirty();
 };
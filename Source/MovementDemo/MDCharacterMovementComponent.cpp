@@ -3,6 +3,9 @@
 
 #include "MovementDemo/MDCharacterMovementComponent.h"
 #include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDCheckpoint.h"
+#include "MovementDemo/MDCheckpointSubsystem.h"
+#include "MovementDemo/MDCheckpointTrackerComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Logging/StructuredLog.h"
 
@@ -43,6 +46,7 @@ UMDCharacterMovementComponent::UMDCharacterMovementComponent()
 	MaxWallRunSpeed = 800.0f;
 	DownwardPullForce = 25.0f;
 	MaxDistanceToTraceForWall = 100.0;
+	CheckpointResetHeight = 200.0f;
 
 	bWantsToSprint = false;
 	bWantsToSlide = false;
@@ -50,11 +54,19 @@ UMDCharacterMovementComponent::UMDCharacterMovementComponent()
 	bIsSliding = false;
 	bWantsToJumpOffWall = false;
 	bWasSlidingBeforeFalling = false;
+	bIsPerformingMove = false;
+
+	RaceClock = 0.0;
+	MoveSegmentStartRaceClock = 0.0;
+	MoveSegmentDeltaTime = 0.0f;
+	MoveSegmentStartLocation = FVector::ZeroVector;
 
 	MinHeightFromFloor_Mantle = 80.0;
 	MaxHeightFromFloor_Mantle = 250.0;
 	ForwardTraceLength_Mantle = 50.0;
 	MaxIterations_Mantle = 30;
+
+	SetMoveResponseDataContainer(MDMoveResponseDataContainer);
 }
 
 FNetworkPredictionData_Client* UMDCharacterMovementComponent::GetPredictionData_Client() const
@@ -76,9 +88,33 @@ void UMDCharacterMovementComponent::TickComponent(float DeltaTime, ELevelTick Ti
 		return;
 	}
 
+	PublishAnimSnapshot();
+
 	// Can easily add debug logging here if needed
 }
 
+void UMDCharacterMovementComponent::PublishAnimSnapshot()
+{
+	// Nothing animates on dedicated server
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	const auto* MDCharacter = CastChecked<AMDCharacter>(CharacterOwner);
+
+	AnimSnapshot.Velocity = GetLastUpdateVelocity();
+	// For controlled pawns this goes trough GetPlayerViewPoint, do it once here rather than in every anim update
+	AnimSnapshot.AimRotation = MDCharacter->GetBaseAimRotation();
+	AnimSnapshot.PawnRotation = MDCharacter->GetActorRotation();
+	AnimSnapshot.WallRunSide = MDCharacter->GetWallRunSide();
+	AnimSnapshot.bIsFalling = IsFalling();
+	AnimSnapshot.bIsWallRunning = IsWallRunning();
+	AnimSnapshot.bIsCrouching = IsCrouching();
+	AnimSnapshot.bIsSliding = MDCharacter->IsSliding();
+	AnimSnapshot.bIsMantling = MDCharacter->IsMantling();
+}
+
 void UMDCharacterMovementComponent::PhysicsRotation(float DeltaTime)
 {
 	if (MovementMode == MOVE_Custom && CustomMovementMode == MDMOVE_Rooted)
@@ -387,6 +423,59 @@ void UMDCharacterMovementComponent::DoMantle(const FMantleInfo& MantleInfo)
 	}
 }
 
+void UMDCharacterMovementComponent::ResetRaceClock()
+{
+	RaceClock = 0.0;
+	MoveSegmentStartRaceClock = 0.0;
+	MoveSegmentDeltaTime = 0.0f;
+}
+
+double UMDCharacterMovementComponent::GetRaceClockAlongCurrentMove(double Alpha) const
+{
+	if(!bIsPerformingMove)
+	{
+		return RaceClock;
+	}
+
+	return MoveSegmentStartRaceClock + FMath::Clamp(Alpha, 0.0, 1.0) * MoveSegmentDeltaTime;
+}
+
+float UMDCharacterMovementComponent::GetCurrentMoveTimeStamp() const
+{
+	if(GetOwnerRole() == ROLE_Authority)
+	{
+		return HasPredictionData_Server() ? GetPredictionData_Server_Character()->CurrentClientTimeStamp : 0.0f;
+	}
+
+	// Replayed moves keep their original timestamps
+	if(const auto* ReplayedMove = GetCurrentReplayedSavedMove())
+	{
+		return ReplayedMove->bOldTimeStampBeforeReset ? ReplayedMove->TimeStamp - MinTimeBetweenTimeStampResets : ReplayedMove->TimeStamp;
+	}
+	return HasPredictionData_Client() ? GetPredictionData_Client_Character()->CurrentTimeStamp : 0.0f;
+}
+
+float UMDCharacterMovementComponent::RebaseServerMoveTimeStamp(float TimeStamp) const
+{
+	// Server can't have processed a move we haven't made yet, so anything ahead of us was made before the reset
+	const float CurrentTimeStamp = GetPredictionData_Client_Character()->CurrentTimeStamp;
+	return TimeStamp > CurrentTimeStamp ? TimeStamp - MinTimeBetweenTimeStampResets : TimeStamp;
+}
+
+void UMDCharacterMovementComponent::ConfirmSavedMoveCheckpointIndex(int32 CheckpointIndex, float TimeStamp)
+{
+	for(const FSavedMovePtr& SavedMove : GetPredictionData_Client_Character()->SavedMoves)
+	{
+		auto* MDSavedMove = static_cast<FMDSavedMove*>(SavedMove.Get());
+		const float MoveTimeStamp = MDSavedMove->bOldTimeStampBeforeReset ? MDSavedMove->TimeStamp - MinTimeBetweenTimeStampResets : MDSavedMove->TimeStamp;
+		if(MoveTimeStamp > TimeStamp && MDSavedMove->CheckpointIndexTimeStamp <= TimeStamp)
+		{
+			MDSavedMove->CheckpointIndex = CheckpointIndex;
+			MDSavedMove->CheckpointIndexTimeStamp = TimeStamp;
+		}
+	}
+}
+
 bool UMDCharacterMovementComponent::CanStartSprinting() const
 {
 	return true;
@@ -583,6 +672,11 @@ void UMDCharacterMovementComponent::PhysWallRun(float DeltaTime, int32 Iteration
 		Velocity = FVector::VectorPlaneProject(Velocity, WallHitResult.Normal);
 		Velocity.Z = -DownwardPullForce;
 
+		// Simulated proxies don't run this, they get the side trough MDCharacter proxy state
+		const FVector RightDirection = FVector::CrossProduct(FVector::UpVector, Velocity.GetSafeNormal2D());
+		const bool bIsWallOnRight = FVector::DotProduct(RightDirection, -WallHitResult.Normal) > 0.0;
+		CastChecked<AMDCharacter>(CharacterOwner)->SetWallRunSide(bIsWallOnRight ? EMDWallRunSide::Right : EMDWallRunSide::Left);
+
 		if(Velocity.SizeSquared() < FMath::Square(MinSpeedToKeepWallRunning))
 		{
 			SetMovementMode(MOVE_Falling);
@@ -687,6 +781,47 @@ void UMDCharacterMovementComponent::JumpOffTheWall(const FVector& WallJumpVeloci
 	bWantsToJumpOffWall = false;
 }
 
+bool UMDCharacterMovementComponent::TryResetToCheckpoint()
+{
+	// Rooted players are waiting for the starting shot
+	if(MovementMode == MOVE_Custom && CustomMovementMode == MDMOVE_Rooted)
+	{
+		return false;
+	}
+
+	const auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(GetCharacterOwner())->GetCheckpointTrackerComp();
+	if(!CheckpointTrackerComp)
+	{
+		return false;
+	}
+
+	const auto* CurrentCheckpoint = CheckpointTrackerComp->GetCurrentCheckpoint();
+	const auto* NextCheckpoint = CheckpointTrackerComp->GetNextCheckpoint();
+	if(!IsValid(CurrentCheckpoint) || !IsValid(NextCheckpoint))
+	{
+		return false;
+	}
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FVector NextCheckpointLocation = NextCheckpoint->GetActorLocation();
+	if(Location.Z >= NextCheckpointLocation.Z)
+	{
+		return false;
+	}
+
+	const FVector NewLocation = CurrentCheckpoint->GetActorLocation() + FVector::UpVector * CheckpointResetHeight;
+	const FRotator NewRotation(0.0, (NextCheckpointLocation - Location).Rotation().Yaw, 0.0);
+	UpdatedComponent->SetWorldLocationAndRotation(NewLocation, NewRotation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	if(bIsSliding)
+	{
+		StopSliding();
+	}
+	RemoveRootMotionSource(RootMotionName_Mantle);
+	OnTeleported();
+	return true;
+}
+
 void UMDCharacterMovementComponent::SetPostLandedPhysics(const FHitResult& Hit)
 {
 	Super::SetPostLandedPhysics(Hit);
@@ -707,6 +842,8 @@ void UMDCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float Del
 	if (CharacterOwner->GetLocalRole() != ROLE_SimulatedProxy)
 	{
 		auto* MDCharacter = CastChecked<AMDCharacter>(GetCharacterOwner());
+		// Fell off the course, go back to the current checkpoint before doing anything else
+		TryResetToCheckpoint();
 		// Check for a change in crouch state. Players toggle crouch by changing bWantsToCrouch.
 		// Force crouch when sliding
 		const bool bIsCrouching = IsCrouching();
@@ -768,6 +905,16 @@ void UMDCharacterMovementComponent::UpdateCharacterStateAfterMovement(float Delt
 		{
 			StopSliding();
 		}
+		if(!IsWallRunning())
+		{
+			CastChecked<AMDCharacter>(CharacterOwner)->SetWallRunSide(EMDWallRunSide::None);
+		}
+
+		// Server picks net update rate from the state we ended up in
+		if(CharacterOwner->HasAuthority())
+		{
+			CastChecked<AMDCharacter>(CharacterOwner)->UpdateNetUpdateState();
+		}
 	}
 }
 
@@ -778,6 +925,21 @@ void UMDCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
 	bWantsToSlide = (Flags & FSavedMove_Character::FLAG_Custom_1) != 0;
 }
 
+void UMDCharacterMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	// Before Super, so the moves replayed after the correction already use server's checkpoint
+	if(!MoveResponse.IsGoodMove() && HasValidData())
+	{
+		const auto& MDMoveResponse = static_cast<const FMDCharacterMoveResponseDataContainer&>(MoveResponse);
+		if(auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(CharacterOwner)->GetCheckpointTrackerComp())
+		{
+			CheckpointTrackerComp->SetCurrentCheckpointIndexFromServer(MDMoveResponse.CheckpointIndex, MoveResponse.ClientAdjustment.TimeStamp);
+		}
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
 bool UMDCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
 {
 	// Basically we copy Super and add our input flags, UGLY but has to be done
@@ -955,6 +1117,39 @@ void UMDCharacterMovementComponent::MoveAutonomous(float ClientTimeStamp, float
 	}
 }
 
+void UMDCharacterMovementComponent::PerformMovement(float DeltaTime)
+{
+	// Server decides race results, so only authority needs to know what segment each move covers.
+	// For remote players DeltaTime comes from the client move timestamps, so the race clock doesn't depend on the server tick rate.
+	const bool bTrackMoveSegment = GetOwnerRole() == ROLE_Authority && UpdatedComponent;
+	if(bTrackMoveSegment)
+	{
+		MoveSegmentStartLocation = UpdatedComponent->GetComponentLocation();
+		MoveSegmentStartRaceClock = RaceClock;
+		MoveSegmentDeltaTime = DeltaTime;
+		bIsPerformingMove = true;
+	}
+
+	Super::PerformMovement(DeltaTime);
+
+	if(bTrackMoveSegment)
+	{
+		bIsPerformingMove = false;
+		RaceClock += DeltaTime;
+
+		// Standings only need updating for racers that actually moved
+		if(HasValidData() && !UpdatedComponent->GetComponentLocation().Equals(MoveSegmentStartLocation))
+		{
+			auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(CharacterOwner)->GetCheckpointTrackerComp();
+			auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>();
+			if(CheckpointTrackerComp && CheckpointSubsystem)
+			{
+				CheckpointSubsystem->OnTrackerMoved(*CheckpointTrackerComp);
+			}
+		}
+	}
+}
+
 
 // Classes needed for network and prediction
 // -----------------------------------------
@@ -965,6 +1160,8 @@ void FMDSavedMove::Clear()
 	Super::Clear();
 	bWantsToSprint = false;
 	bWantsToSlide = false;
+	CheckpointIndex = INDEX_NONE;
+	CheckpointIndexTimeStamp = TNumericLimits<float>::Lowest();
 }
 
 uint8 FMDSavedMove::GetCompressedFlags() const
@@ -987,6 +1184,12 @@ void FMDSavedMove::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector
 	const auto* MovementComponent = CastChecked<UMDCharacterMovementComponent>(Character->GetCharacterMovement());
 	bWantsToSprint = MovementComponent->bWantsToSprint;
 	bWantsToSlide = MovementComponent->bWantsToSlide;
+
+	if(const auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(Character)->GetCheckpointTrackerComp())
+	{
+		CheckpointIndex = CheckpointTrackerComp->GetCurrentCheckpointIndex();
+		CheckpointIndexTimeStamp = CheckpointTrackerComp->GetCheckpointIndexTimeStamp();
+	}
 }
 
 void FMDSavedMove::PrepMoveFor(ACharacter* Character)
@@ -995,6 +1198,21 @@ void FMDSavedMove::PrepMoveFor(ACharacter* Character)
 	auto* MovementComponent = CastChecked<UMDCharacterMovementComponent>(Character->GetCharacterMovement());
 	MovementComponent->bWantsToSprint = bWantsToSprint;
 	MovementComponent->bWantsToSlide = bWantsToSlide;
+
+	// Otherwise the move would be replayed with the checkpoint of our latest move, and could reset where it didn't
+	if(auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(Character)->GetCheckpointTrackerComp())
+	{
+		CheckpointTrackerComp->RestoreSavedMoveCheckpointIndex(CheckpointIndex, CheckpointIndexTimeStamp);
+	}
+}
+
+bool FMDSavedMove::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	if(CheckpointIndex != static_cast<const FMDSavedMove*>(NewMove.Get())->CheckpointIndex)
+	{
+		return false;
+	}
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
 }
 
 // End SavedMove
@@ -1008,4 +1226,53 @@ FSavedMovePtr FMDNetworkPredictionData_Client::AllocateNewMove()
 {
 	return MakeShared<FMDSavedMove>();
 }
+
+float FMDNetworkPredictionData_Client::UpdateTimeStampAndDeltaTime(float DeltaTime, ACharacter& CharacterOwner, UCharacterMovementComponent& CharacterMovementComponent)
+{
+	const float OldTimeStamp = CurrentTimeStamp;
+	const float Result = Super::UpdateTimeStampAndDeltaTime(DeltaTime, CharacterOwner, CharacterMovementComponent);
+
+	// Super moved the timestamp back by MinTimeBetweenTimeStampResets. Checkpoint index tags are compared against new timestamps, so they go back by the same amount.
+	if(CurrentTimeStamp < OldTimeStamp)
+	{
+		const float Offset = CharacterMovementComponent.MinTimeBetweenTimeStampResets;
+		for(const FSavedMovePtr& SavedMove : SavedMoves)
+		{
+			static_cast<FMDSavedMove*>(SavedMove.Get())->CheckpointIndexTimeStamp -= Offset;
+		}
+		if(auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(&CharacterOwner)->GetCheckpointTrackerComp())
+		{
+			CheckpointTrackerComp->RebaseCheckpointIndexTimeStamp(Offset);
+		}
+	}
+	return Result;
+}
 // End NetworkPredictionData_Client
+
+// MoveResponseDataContainer
+void FMDCharacterMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const auto* CheckpointTrackerComp = CastChecked<AMDCharacter>(CharacterMovement.GetCharacterOwner())->GetCheckpointTrackerComp();
+	CheckpointIndex = CheckpointTrackerComp ? CheckpointTrackerComp->GetCurrentCheckpointIndex() : INDEX_NONE;
+}
+
+bool FMDCharacterMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if(!Super::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	// Same encoding as AMDCharacter::ClientSetCheckpointIndex, good moves don't need it
+	if(!IsGoodMove())
+	{
+		uint16 EncodedIndex = static_cast<uint16>(CheckpointIndex + 1);
+		Ar << EncodedIndex;
+		CheckpointIndex = static_cast<int32>(EncodedIndex) - 1;
+	}
+
+	return !Ar.IsError();
+}
+// End MoveResponseDataContainer
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "MovementDemo/MDProxyState.h"
 #include "MDCharacterMovementComponent.generated.h"
 
 
@@ -19,6 +20,44 @@ struct FMantleInfo
 	bool bCanMantle = false;
 };
 
+// Everything animation needs from the character, published by the movement component at the end of its tick.
+// Mesh ticks after movement, so anim instance can read this from a worker thread without touching the pawn.
+struct FMDAnimSnapshot
+{
+	FMDAnimSnapshot() : bIsFalling(false), bIsWallRunning(false), bIsCrouching(false), bIsSliding(false), bIsMantling(false) {}
+
+	FVector Velocity = FVector::ZeroVector;
+
+	FRotator AimRotation = FRotator::ZeroRotator;
+
+	FRotator PawnRotation = FRotator::ZeroRotator;
+
+	EMDWallRunSide WallRunSide = EMDWallRunSide::None;
+
+	uint8 bIsFalling:1;
+
+	uint8 bIsWallRunning:1;
+
+	uint8 bIsCrouching:1;
+
+	uint8 bIsSliding:1;
+
+	uint8 bIsMantling:1;
+};
+
+// Corrections also carry server's checkpoint index, so a client that predicted a checkpoint server never reached gets back on the right one before replaying.
+struct FMDCharacterMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	typedef FCharacterMoveResponseDataContainer Super;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+
+	// Only valid when the response is not a good move
+	int32 CheckpointIndex = INDEX_NONE;
+};
+
 UENUM(BlueprintType)
 enum EMDCustomMovementMode
 {
@@ -75,12 +114,42 @@ public:
 
 	bool IsWallRunning() const;
 
+	bool IsSprinting() const { return bIsSprinting; }
+
+	// Written once per tick on game thread, see FMDAnimSnapshot
+	const FMDAnimSnapshot& GetAnimSnapshot() const { return AnimSnapshot; }
+
 	bool CanStartMantle() const;
 
 	FMantleInfo TryFindMantleLocation() const;
 
 	void DoMantle(const FMantleInfo& MantleInfo);
 
+	// Race clock is the simulated movement time since the starting shot. Only advanced on authority.
+	void ResetRaceClock();
+
+	double GetRaceClock() const { return RaceClock; }
+
+	// Location of the capsule at the start of the move that is being performed, or the last one if we are not inside a move.
+	const FVector& GetMoveSegmentStartLocation() const { return MoveSegmentStartLocation; }
+
+	// Race clock at given Alpha (0..1) along the move that is being performed. Outside of a move, returns current race clock.
+	double GetRaceClockAlongCurrentMove(double Alpha) const;
+
+	// Client timestamp of the move that is being performed, or the last one. On server, the client move that is being processed.
+	// Moves replayed from before a client timestamp reset are moved back by the reset interval, so they compare against current ones.
+	float GetCurrentMoveTimeStamp() const;
+
+	// Owning client only. Same as above for a timestamp server sent us, it can be from before our last timestamp reset.
+	float RebaseServerMoveTimeStamp(float TimeStamp) const;
+
+	// Owning client only. Saved moves after TimeStamp take server's checkpoint index, unless they predicted their own after it.
+	void ConfirmSavedMoveCheckpointIndex(int32 CheckpointIndex, float TimeStamp);
+
+	// How far above the current checkpoint we are placed when we fall below the next one.
+	UPROPERTY(Category = "Character Movement: Checkpoints", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm"))
+	float CheckpointResetHeight;
+
 	UPROPERTY(Category = "Character Movement: Walking", EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm/s"))
 	float MaxSprintSpeed;
 
@@ -170,6 +239,22 @@ protected:
 
 	uint32 bWasSlidingBeforeFalling:1;
 
+	uint32 bIsPerformingMove:1;
+
+	double RaceClock;
+
+	double MoveSegmentStartRaceClock;
+
+	float MoveSegmentDeltaTime;
+
+	FVector MoveSegmentStartLocation;
+
+	FMDAnimSnapshot AnimSnapshot;
+
+	FMDCharacterMoveResponseDataContainer MDMoveResponseDataContainer;
+
+	void PublishAnimSnapshot();
+
 	bool CanStartSprinting() const;
 
 	void StartSprinting();
@@ -194,6 +279,9 @@ protected:
 
 	void JumpOffTheWall(const FVector& WallJumpVelocity);
 
+	// Places character back to the current checkpoint if it has fallen below the next one. Runs as part of the move, so owning client predicts it and server does the same when it receives the move.
+	bool TryResetToCheckpoint();
+
 	virtual void SetPostLandedPhysics(const FHitResult& Hit) override;
 
 	bool ShouldSlideOnLanded(const FHitResult& Hit) const;
@@ -206,8 +294,13 @@ protected:
 
 	virtual bool ClientUpdatePositionAfterServerUpdate() override;
 
+	// Takes server's checkpoint index from corrections before the saved moves are replayed
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+
 	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
 
+	virtual void PerformMovement(float DeltaTime) override;
+
 	friend class FMDSavedMove;
 };
 
@@ -231,9 +324,18 @@ public:
 	// Sets variables on character movement component before making a predictive correction.
 	virtual void PrepMoveFor(ACharacter* Character) override;
 
+	// Moves made with different checkpoints can't be sent as one.
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+
 	uint32 bWantsToSprint:1;
 
 	uint32 bWantsToSlide:1;
+
+	// Checkpoint the move was made with, so a replay resets to the same one. Not sent to server.
+	int32 CheckpointIndex;
+
+	// See UMDCheckpointTrackerComponent::GetCheckpointIndexTimeStamp
+	float CheckpointIndexTimeStamp;
 };
 
 class FMDNetworkPredictionData_Client : public FNetworkPredictionData_Client_Character
@@ -245,4 +347,7 @@ public:
 	FMDNetworkPredictionData_Client(const UCharacterMovementComponent& ClientMovement);
 
 	virtual FSavedMovePtr AllocateNewMove() override;
+
+	// Also moves checkpoint index timestamps back when the client timestamp is reset.
+	virtual float UpdateTimeStampAndDeltaTime(float DeltaTime, ACharacter& CharacterOwner, UCharacterMovementComponent& CharacterMovementComponent) override;
 };
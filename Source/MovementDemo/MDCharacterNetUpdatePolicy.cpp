@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDCharacterNetUpdatePolicy.h"
+#include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
+#include "Logging/StructuredLog.h"
+
+namespace MDNetUpdateStats
+{
+	static double TimeInState[static_cast<int32>(EMDNetUpdateState::Count)] = {};
+
+	static int64 NetUpdatesInState[static_cast<int32>(EMDNetUpdateState::Count)] = {};
+
+	static FAutoConsoleCommand DumpCmd(
+		TEXT("MD.NetUpdateStats"),
+		TEXT("Prints time and net updates per character movement state, summed over all characters on this server."),
+		FConsoleCommandDelegate::CreateStatic(&UMDCharacterNetUpdatePolicy::DumpStats));
+
+	static FAutoConsoleCommand ResetCmd(
+		TEXT("MD.NetUpdateStats.Reset"),
+		TEXT("Resets character net update stats."),
+		FConsoleCommandDelegate::CreateStatic(&UMDCharacterNetUpdatePolicy::ResetStats));
+}
+
+UMDCharacterNetUpdatePolicy::UMDCharacterNetUpdatePolicy()
+{
+	Rooted.NetUpdateFrequency = 2.0f;
+	Rooted.NetPriority = 1.0f;
+
+	Idle.NetUpdateFrequency = 5.0f;
+	Idle.NetPriority = 1.0f;
+
+	Moving.NetUpdateFrequency = 20.0f;
+	Moving.NetPriority = 2.0f;
+
+	// Steady, extrapolates well
+	Sprinting.NetUpdateFrequency = 15.0f;
+	Sprinting.NetPriority = 2.0f;
+
+	Sliding.NetUpdateFrequency = 20.0f;
+	Sliding.NetPriority = 3.0f;
+
+	Falling.NetUpdateFrequency = 20.0f;
+	Falling.NetPriority = 3.0f;
+
+	WallRunning.NetUpdateFrequency = 30.0f;
+	WallRunning.NetPriority = 4.0f;
+	WallRunning.bForceNetUpdateOnEnter = true;
+
+	Mantling.NetUpdateFrequency = 30.0f;
+	Mantling.NetPriority = 4.0f;
+	Mantling.bForceNetUpdateOnEnter = true;
+}
+
+EMDNetUpdateState UMDCharacterNetUpdatePolicy::GetStateFor(const AMDCharacter& Character) const
+{
+	const auto* MoveComp = CastChecked<UMDCharacterMovementComponent>(Character.GetCharacterMovement());
+
+	if(MoveComp->MovementMode == MOVE_Custom && MoveComp->CustomMovementMode == MDMOVE_Rooted)
+	{
+		return EMDNetUpdateState::Rooted;
+	}
+	if(Character.IsMantling())
+	{
+		return EMDNetUpdateState::Mantling;
+	}
+	if(MoveComp->IsWallRunning())
+	{
+		return EMDNetUpdateState::WallRunning;
+	}
+	if(MoveComp->IsFalling())
+	{
+		return EMDNetUpdateState::Falling;
+	}
+	if(Character.IsSliding())
+	{
+		return EMDNetUpdateState::Sliding;
+	}
+	if(MoveComp->GetCurrentAcceleration().IsNearlyZero() && MoveComp->Velocity.SizeSquared() < FMath::Square(IdleSpeed))
+	{
+		return EMDNetUpdateState::Idle;
+	}
+	return MoveComp->IsSprinting() ? EMDNetUpdateState::Sprinting : EMDNetUpdateState::Moving;
+}
+
+const FMDNetUpdateSettings& UMDCharacterNetUpdatePolicy::GetSettings(EMDNetUpdateState State) const
+{
+	switch (State)
+	{
+		case EMDNetUpdateState::Rooted:
+			return Rooted;
+		case EMDNetUpdateState::Idle:
+			return Idle;
+		case EMDNetUpdateState::Sprinting:
+			return Sprinting;
+		case EMDNetUpdateState::Sliding:
+			return Sliding;
+		case EMDNetUpdateState::Falling:
+			return Falling;
+		case EMDNetUpdateState::WallRunning:
+			return WallRunning;
+		case EMDNetUpdateState::Mantling:
+			return Mantling;
+		default:
+			return Moving;
+	}
+}
+
+void UMDCharacterNetUpdatePolicy::ApplyState(AMDCharacter& Character, EMDNetUpdateState State) const
+{
+	const auto& Settings = GetSettings(State);
+	Character.NetUpdateFrequency = Settings.NetUpdateFrequency;
+	// Adaptive net update frequency can't go under this. Start from the class default so it comes back up after slow states.
+	const auto* DefaultCharacter = Character.GetClass()->GetDefaultObject<AMDCharacter>();
+	Character.MinNetUpdateFrequency = FMath::Min(DefaultCharacter->MinNetUpdateFrequency, Settings.NetUpdateFrequency);
+	Character.NetPriority = Settings.NetPriority;
+
+	if(Settings.bForceNetUpdateOnEnter)
+	{
+		Character.ForceNetUpdate();
+	}
+}
+
+void UMDCharacterNetUpdatePolicy::RecordTimeInState(EMDNetUpdateState State, double Seconds)
+{
+	MDNetUpdateStats::TimeInState[static_cast<int32>(State)] += Seconds;
+}
+
+void UMDCharacterNetUpdatePolicy::RecordNetUpdate(EMDNetUpdateState State)
+{
+	++MDNetUpdateStats::NetUpdatesInState[static_cast<int32>(State)];
+}
+
+void UMDCharacterNetUpdatePolicy::DumpStats()
+{
+	// Bytes per update are about the same for all states, so updates per second is what the policy changes. Use Network Insights for exact bytes.
+	UE_LOGFMT(LogTemp, Log, "Character net updates per state (time is summed over characters, counted when state is left):");
+	for(int32 Index = 0; Index < static_cast<int32>(EMDNetUpdateState::Count); ++Index)
+	{
+		const double Time = MDNetUpdateStats::TimeInState[Index];
+		const int64 NumUpdates = MDNetUpdateStats::NetUpdatesInState[Index];
+		UE_LOGFMT(LogTemp, Log, "  {0}: {1} s, {2} updates, {3} updates/s", UEnum::GetValueAsString(static_cast<EMDNetUpdateState>(Index)), Time, NumUpdates, Time > 0.0 ? NumUpdates / Time : 0.0);
+	}
+}
+
+void UMDCharacterNetUpdatePolicy::ResetStats()
+{
+	for(int32 Index = 0; Index < static_cast<int32>(EMDNetUpdateState::Count); ++Index)
+	{
+		MDNetUpdateStats::TimeInState[Index] = 0.0;
+		MDNetUpdateStats::NetUpdatesInState[Index] = 0;
+	}
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "MDCharacterNetUpdatePolicy.generated.h"
+
+class AMDCharacter;
+
+UENUM()
+enum class EMDNetUpdateState : uint8
+{
+	Rooted,
+	Idle,
+	Moving,
+	Sprinting,
+	Sliding,
+	Falling,
+	WallRunning,
+	Mantling,
+	Count UMETA(Hidden),
+};
+
+USTRUCT()
+struct FMDNetUpdateSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "1", UIMin = "1", ForceUnits = "Hz"))
+	float NetUpdateFrequency = 30.0f;
+
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", UIMin = "0"))
+	float NetPriority = 3.0f;
+
+	// Send the new state right away when entering, for transitions that proxies can't guess
+	UPROPERTY(EditAnywhere, Config)
+	bool bForceNetUpdateOnEnter = false;
+};
+
+/**
+ * Chooses net update frequency and priority for MDCharacter from what it's doing.
+ * Rooted and idle characters barely change, steady sprints extrapolate well on proxies, wall run and mantle transitions need to arrive quickly.
+ * Only CDO is used (see AMDCharacter::NetUpdatePolicyClass), values are tuned in DefaultGame.ini.
+ * Keeps server wide stats of time and net updates per state, print them with MD.NetUpdateStats.
+ * Replication Graph honors the frequency trough racer frequency buckets, NetPriority only affects the generic replication path.
+ */
+UCLASS(Config = Game)
+class MOVEMENTDEMO_API UMDCharacterNetUpdatePolicy : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UMDCharacterNetUpdatePolicy();
+
+	virtual EMDNetUpdateState GetStateFor(const AMDCharacter& Character) const;
+
+	const FMDNetUpdateSettings& GetSettings(EMDNetUpdateState State) const;
+
+	// Applies settings of the state to the character. Called on server when state changes.
+	virtual void ApplyState(AMDCharacter& Character, EMDNetUpdateState State) const;
+
+	static void RecordTimeInState(EMDNetUpdateState State, double Seconds);
+
+	static void RecordNetUpdate(EMDNetUpdateState State);
+
+	static void DumpStats();
+
+	static void ResetStats();
+
+	// Speed under which a character without input is idle
+	UPROPERTY(EditAnywhere, Config, meta = (ForceUnits = "cm/s"))
+	float IdleSpeed = 10.0f;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Rooted;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Idle;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Moving;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Sprinting;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Sliding;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Falling;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings WallRunning;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDNetUpdateSettings Mantling;
+};
@@ -12,6 +12,9 @@ AMDCheckpoint::AMDCheckpoint()
 {
 	PrimaryActorTick.bCanEverTick = false;
 
+	// Checkpoints never change after load, server doesn't need to consider them for replication
+	NetDormancy = DORM_Initial;
+
 	RootMeshComp = CreateDefaultSubobject<UStaticMeshComponent>("RootMeshComp");
 	SetRootComponent(RootMeshComp);
 
@@ -25,33 +28,73 @@ void AMDCheckpoint::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
-	if (GetNetMode() < NM_Client)
+	// Clients register too, so they have the same route as the server
+	if (auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
 	{
-		if (auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
+		CheckpointSubsystem->RegisterCheckpoint(*this);
+	}
+}
+
+double AMDCheckpoint::ComputeEntryAlpha(const FVector& Start, const FVector& End, const FVector& Extent) const
+{
+	// Do the math in trigger's local space, so rotated triggers work too. Extent is grown by the passed in shape, so we can treat the shape as a point.
+	const FTransform& TriggerTransform = TriggerComp->GetComponentTransform();
+	const FVector LocalStart = TriggerTransform.InverseTransformPosition(Start);
+	const FVector LocalDelta = TriggerTransform.InverseTransformPosition(End) - LocalStart;
+	const FVector Scale = TriggerTransform.GetScale3D().GetAbs().ComponentMax(FVector(UE_KINDA_SMALL_NUMBER));
+	const FVector LocalExtent = TriggerComp->GetUnscaledBoxExtent() + Extent / Scale;
+
+	// Slab test, we only care about the entry time
+	double EntryAlpha = 0.0;
+	double ExitAlpha = 1.0;
+	for(int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		if(FMath::IsNearlyZero(LocalDelta[Axis]))
+		{
+			if(FMath::Abs(LocalStart[Axis]) > LocalExtent[Axis])
+			{
+				return 1.0;
+			}
+			continue;
+		}
+
+		double Near = (-LocalExtent[Axis] - LocalStart[Axis]) / LocalDelta[Axis];
+		double Far = (LocalExtent[Axis] - LocalStart[Axis]) / LocalDelta[Axis];
+		if(Near > Far)
 		{
-			CheckpointSubsystem->RegisterCheckpoint(*this);
+			Swap(Near, Far);
+		}
+
+		EntryAlpha = FMath::Max(EntryAlpha, Near);
+		ExitAlpha = FMath::Min(ExitAlpha, Far);
+		if(EntryAlpha > ExitAlpha)
+		{
+			return 1.0;
 		}
 	}
+
+	return EntryAlpha;
+}
+
+void AMDCheckpoint::SetRenderedByCourse(bool bRenderedByCourse)
+{
+	// Hidden primitive is not added to the scene at all
+	RootMeshComp->SetVisibility(!bRenderedByCourse);
 }
 
 void AMDCheckpoint::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if(GetNetMode() < NM_Client)
-	{
-		TriggerComp->OnComponentBeginOverlap.AddDynamic(this, &ThisClass::OnTriggerOverlap);
-	}
+	// Clients predict their own progress
+	TriggerComp->OnComponentBeginOverlap.AddDynamic(this, &ThisClass::OnTriggerOverlap);
 }
 
 void AMDCheckpoint::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (GetNetMode() < NM_Client)
+	if (auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
 	{
-		if (auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
-		{
-			CheckpointSubsystem->UnregisterCheckpoint(*this);
-		}
+		CheckpointSubsystem->UnregisterCheckpoint(*this);
 	}
 
 	Super::EndPlay(EndPlayReason);
@@ -59,15 +102,20 @@ void AMDCheckpoint::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 void AMDCheckpoint::OnTriggerOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
-	check(GetNetMode() < NM_Client);
-
 	if(const auto* MDCharacter = Cast<AMDCharacter>(OtherActor))
 	{
 		if (auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
 		{
 			if(auto* CheckpointComp = MDCharacter->GetCheckpointTrackerComp())
 			{
-				CheckpointSubsystem->OnTrackerOverlappedCheckpoint(*CheckpointComp, *this);
+				if(MDCharacter->HasAuthority())
+				{
+					CheckpointSubsystem->OnTrackerOverlappedCheckpoint(*CheckpointComp, *this);
+				}
+				else if(MDCharacter->IsLocallyControlled())
+				{
+					CheckpointSubsystem->PredictTrackerOverlappedCheckpoint(*CheckpointComp, *this);
+				}
 			}
 		}
 	}
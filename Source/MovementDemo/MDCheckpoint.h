@@ -11,6 +11,7 @@ class UBoxComponent;
 /**
  * Checkpoint for MDCharacters. When character steps on this checkpoint, it will set as a current checkpoint.
  * Can be placed inside levels.
+ * Mesh is usually hidden at runtime and drawn by MDCheckpointCourse together with other checkpoints. Collision and trigger stay here.
  * See MDCheckpointSubsystem.h for overview of checkpoint system.
  */
 UCLASS()
@@ -24,6 +25,14 @@ public:
 
 	virtual void PostInitializeComponents() override;
 
+	// Returns how far along Start -> End (0..1) a box with given Extent enters the trigger. Returns 1 if it doesn't enter it at all.
+	double ComputeEntryAlpha(const FVector& Start, const FVector& End, const FVector& Extent) const;
+
+	UStaticMeshComponent* GetMeshComp() const { return RootMeshComp; }
+
+	// Hides own mesh while MDCheckpointCourse draws it. Collision is not changed.
+	void SetRenderedByCourse(bool bRenderedByCourse);
+
 protected:
 
 	UPROPERTY(VisibleAnywhere)
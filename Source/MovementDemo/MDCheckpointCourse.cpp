@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDCheckpointCourse.h"
+#include "MovementDemo/MDCheckpoint.h"
+#include "MovementDemo/MDCheckpointSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Logging/StructuredLog.h"
+
+AMDCheckpointCourse::AMDCheckpointCourse()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Instances are in world space
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>("RootComp"));
+}
+
+void AMDCheckpointCourse::Rebuild(const UMDCheckpointSubsystem& CheckpointSubsystem)
+{
+	Clear();
+
+	const int32 NumCheckpoints = CheckpointSubsystem.GetNumCheckpoints();
+	Instances.SetNum(NumCheckpoints);
+	for(int32 Idx = 0; Idx < NumCheckpoints; ++Idx)
+	{
+		auto* Checkpoint = CheckpointSubsystem.GetCheckpoint(Idx);
+		const auto* MeshComp = Checkpoint ? Checkpoint->GetMeshComp() : nullptr;
+		if(!MeshComp || !MeshComp->GetStaticMesh())
+		{
+			continue;
+		}
+
+		auto* Batch = FindOrAddBatch(*MeshComp);
+		FMDCheckpointInstance& Instance = Instances[Idx];
+		Instance.Checkpoint = Checkpoint;
+		Instance.Batch = Batch;
+		Instance.InstanceIndex = Batch->AddInstance(MeshComp->GetComponentTransform(), true);
+		Checkpoint->SetRenderedByCourse(true);
+	}
+
+	UE_LOGFMT(LogTemp, Log, "Checkpoint course: {Num} checkpoints rendered with {Batches} instanced meshes.", NumCheckpoints, Batches.Num());
+
+	// Instance data starts cleared
+	const int32 CurrentIndex = HighlightedIndex;
+	HighlightedIndex = INDEX_NONE;
+	SetHighlightedCheckpoint(CurrentIndex);
+}
+
+void AMDCheckpointCourse::SetHighlightedCheckpoint(int32 CurrentIndex)
+{
+	if(CurrentIndex == HighlightedIndex)
+	{
+		return;
+	}
+
+	if(HighlightedIndex != INDEX_NONE)
+	{
+		SetInstanceHighlight(HighlightedIndex, EMDCheckpointHighlight::None);
+		SetInstanceHighlight(HighlightedIndex + 1, EMDCheckpointHighlight::None);
+	}
+
+	HighlightedIndex = CurrentIndex;
+
+	if(HighlightedIndex != INDEX_NONE)
+	{
+		SetInstanceHighlight(HighlightedIndex, EMDCheckpointHighlight::Current);
+		SetInstanceHighlight(HighlightedIndex + 1, EMDCheckpointHighlight::Next);
+	}
+}
+
+void AMDCheckpointCourse::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Clear();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+UInstancedStaticMeshComponent* AMDCheckpointCourse::FindOrAddBatch(const UStaticMeshComponent& MeshComp)
+{
+	// Batch can only be shared if checkpoints look the same
+	for(auto* Batch : Batches)
+	{
+		if(Batch->GetStaticMesh() != MeshComp.GetStaticMesh() || Batch->GetNumMaterials() != MeshComp.GetNumMaterials())
+		{
+			continue;
+		}
+
+		bool bSameMaterials = true;
+		for(int32 Slot = 0; Slot < MeshComp.GetNumMaterials() && bSameMaterials; ++Slot)
+		{
+			bSameMaterials = Batch->GetMaterial(Slot) == MeshComp.GetMaterial(Slot);
+		}
+		if(bSameMaterials)
+		{
+			return Batch;
+		}
+	}
+
+	auto* Batch = NewObject<UInstancedStaticMeshComponent>(this);
+	Batch->SetStaticMesh(MeshComp.GetStaticMesh());
+	for(int32 Slot = 0; Slot < MeshComp.GetNumMaterials(); ++Slot)
+	{
+		Batch->SetMaterial(Slot, MeshComp.GetMaterial(Slot));
+	}
+	// Checkpoint actors keep their own collision, movement and checkpoint resets are tested against them on server and clients
+	Batch->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Batch->SetCastShadow(MeshComp.CastShadow);
+	Batch->SetNumCustomDataFloats(1);
+	Batch->SetupAttachment(GetRootComponent());
+	Batch->RegisterComponent();
+	Batches.Add(Batch);
+	return Batch;
+}
+
+void AMDCheckpointCourse::SetInstanceHighlight(int32 Index, EMDCheckpointHighlight Highlight)
+{
+	if(!Instances.IsValidIndex(Index))
+	{
+		return;
+	}
+
+	const FMDCheckpointInstance& Instance = Instances[Index];
+	if(auto* Batch = Instance.Batch.Get())
+	{
+		Batch->SetCustomDataValue(Instance.InstanceIndex, 0, static_cast<float>(Highlight), true);
+	}
+}
+
+void AMDCheckpointCourse::Clear()
+{
+	for(const auto& Instance : Instances)
+	{
+		if(auto* Checkpoint = Instance.Checkpoint.Get())
+		{
+			Checkpoint->SetRenderedByCourse(false);
+		}
+	}
+	Instances.Reset();
+
+	for(auto* Batch : Batches)
+	{
+		if(IsValid(Batch))
+		{
+			Batch->DestroyComponent();
+		}
+	}
+	Batches.Reset();
+}
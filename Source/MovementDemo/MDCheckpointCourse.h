@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "MDCheckpointCourse.generated.h"
+
+class AMDCheckpoint;
+class UInstancedStaticMeshComponent;
+class UMDCheckpointSubsystem;
+class UStaticMeshComponent;
+
+// Per instance custom data value (index 0) of a checkpoint. Checkpoint material can read it with PerInstanceCustomData.
+enum class EMDCheckpointHighlight : uint8
+{
+	None = 0,
+	Current = 1,
+	Next = 2,
+};
+
+/**
+ * Renders all checkpoints of the route trough instanced static mesh components, one per mesh and material combination.
+ * Spawned locally by MDCheckpointSubsystem, never on dedicated server. Checkpoint actors stay for collision, triggers and route order,
+ * but their own meshes are hidden, so they don't have a render proxy each.
+ * Current and next checkpoints of the local player are marked with per instance custom data, see EMDCheckpointHighlight.
+ */
+UCLASS(Transient, NotPlaceable)
+class MOVEMENTDEMO_API AMDCheckpointCourse : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AMDCheckpointCourse();
+
+	// Creates instances for the route of the subsystem. Called again whenever the route changes.
+	void Rebuild(const UMDCheckpointSubsystem& CheckpointSubsystem);
+
+	// Route index of local player's current checkpoint, the one after it is highlighted as next. INDEX_NONE clears highlight.
+	void SetHighlightedCheckpoint(int32 CurrentIndex);
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+protected:
+
+	struct FMDCheckpointInstance
+	{
+		TWeakObjectPtr<AMDCheckpoint> Checkpoint;
+
+		TWeakObjectPtr<UInstancedStaticMeshComponent> Batch;
+
+		int32 InstanceIndex = INDEX_NONE;
+	};
+
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> Batches;
+
+	// Same order as the route
+	TArray<FMDCheckpointInstance> Instances;
+
+	int32 HighlightedIndex = INDEX_NONE;
+
+	UInstancedStaticMeshComponent* FindOrAddBatch(const UStaticMeshComponent& MeshComp);
+
+	void SetInstanceHighlight(int32 Index, EMDCheckpointHighlight Highlight);
+
+	// Gives rendering back to checkpoint actors and destroys instances
+	void Clear();
+};
@@ -3,9 +3,13 @@
 
 #include "MovementDemo/MDCheckpointSubsystem.h"
 #include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
 #include "MovementDemo/MDCheckpoint.h"
+#include "MovementDemo/MDCheckpointCourse.h"
 #include "MovementDemo/MDPlayerState.h"
 #include "MovementDemo/MDCheckpointTrackerComponent.h"
+#include "MovementDemo/MDGameStateBase.h"
+#include "Components/CapsuleComponent.h"
 #include "Logging/StructuredLog.h"
 
 UMDCheckpointSubsystem::UMDCheckpointSubsystem()
@@ -15,13 +19,8 @@ UMDCheckpointSubsystem::UMDCheckpointSubsystem()
 
 bool UMDCheckpointSubsystem::ShouldCreateSubsystem(UObject* Outer) const
 {
-	if (!Super::ShouldCreateSubsystem(Outer))
-	{
-		return false;
-	}
-
-	const UWorld* World = CastChecked<UWorld>(Outer);
-	return World->GetNetMode() < NM_Client; // will be created in standalone, dedicated servers, and listen servers
+	// Created everywhere. Clients need the route too, to resolve checkpoint indices sent by the server.
+	return Super::ShouldCreateSubsystem(Outer);
 }
 
 void UMDCheckpointSubsystem::PostInitialize()
@@ -34,32 +33,28 @@ void UMDCheckpointSubsystem::OnWorldBeginPlay(UWorld& InWorld)
 	Super::OnWorldBeginPlay(InWorld);
 
 	SortCheckpoints();
+
+	// Nothing is rendered on dedicated server
+	if(bRenderCheckpointsInstanced && InWorld.GetNetMode() != NM_DedicatedServer)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		Course = InWorld.SpawnActor<AMDCheckpointCourse>(SpawnParams);
+		RebuildCourse();
+	}
 }
 
 void UMDCheckpointSubsystem::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	for(auto& Comp : CheckpointTrackerCompArray)
+	if(GetWorld()->GetNetMode() == NM_Client)
 	{
-		auto* CurrentCheckpoint = Comp->GetCurrentCheckpoint();
-		auto* NextCheckpoint = Comp->GetNextCheckpoint();
-
-		if(IsValid(CurrentCheckpoint) && IsValid(NextCheckpoint))
-		{
-			auto* CompOwner = Comp->GetOwner();
-			auto PlayerZ = CompOwner->GetActorLocation().Z;
-			auto NextCheckpointZ = NextCheckpoint->GetActorLocation().Z;
-
-			// If player is below NextCheckpoint, reset player to CurrentCheckpoint
-			if(PlayerZ < NextCheckpointZ)
-			{
-				FVector NewLoc = CurrentCheckpoint->GetActorLocation() + FVector::UpVector * 200.0;
-				FRotator NewRot = (NextCheckpoint->GetActorLocation() - CompOwner->GetActorLocation()).GetSafeNormal().Rotation();
-				CompOwner->TeleportTo(NewLoc, NewRot, false, true);
-			}
-		}
+		return;
 	}
+
+	// Standings are updated as racers move, see OnTrackerMoved
+	PublishStandings();
 }
 
 TStatId UMDCheckpointSubsystem::GetStatId() const
@@ -76,6 +71,7 @@ void UMDCheckpointSubsystem::RegisterCheckpoint(AMDCheckpoint& NewCheckpoint)
 	if(GetWorld()->HasBegunPlay())
 	{
 		SortCheckpoints();
+		RebuildCourse();
 	}
 }
 
@@ -83,54 +79,269 @@ void UMDCheckpointSubsystem::UnregisterCheckpoint(AMDCheckpoint& CheckpointToRem
 {
 	check(CheckpointsArray.Contains(&CheckpointToRemove));
 	CheckpointsArray.RemoveSingle(&CheckpointToRemove);
+
+	if(GetWorld()->HasBegunPlay() && !GetWorld()->bIsTearingDown)
+	{
+		RebuildCourse();
+	}
 }
 
 void UMDCheckpointSubsystem::RegisterCheckpointTracker(UMDCheckpointTrackerComponent& CheckpointTrackerComp)
 {
 	check(!CheckpointTrackerCompArray.Contains(&CheckpointTrackerComp));
 	CheckpointTrackerCompArray.Emplace(&CheckpointTrackerComp);
+
+	// New racers start from the back
+	FMDRaceStanding& Standing = Standings.AddDefaulted_GetRef();
+	Standing.Tracker = &CheckpointTrackerComp;
+	CheckpointTrackerComp.RacePosition = Standings.Num() - 1;
+	UpdateStandingRemaining(Standing);
+	FixStandingPosition(CheckpointTrackerComp.RacePosition);
+	bStandingsOrderChanged = true;
 }
 
 void UMDCheckpointSubsystem::UnregisterCheckpointTracker(UMDCheckpointTrackerComponent& CheckpointTrackerComp)
 {
 	check(CheckpointTrackerCompArray.Contains(&CheckpointTrackerComp));
 	CheckpointTrackerCompArray.RemoveSingleSwap(&CheckpointTrackerComp);
+
+	const int32 Position = CheckpointTrackerComp.RacePosition;
+	check(Standings.IsValidIndex(Position) && Standings[Position].Tracker == &CheckpointTrackerComp);
+	Standings.RemoveAt(Position);
+	for(int32 Idx = Position; Idx < Standings.Num(); ++Idx)
+	{
+		if(auto* Tracker = Standings[Idx].Tracker.Get())
+		{
+			Tracker->RacePosition = Idx;
+		}
+	}
+	CheckpointTrackerComp.RacePosition = INDEX_NONE;
+	bStandingsOrderChanged = true;
 }
 
 void UMDCheckpointSubsystem::OnTrackerOverlappedCheckpoint(UMDCheckpointTrackerComponent& CheckpointTrackerComp, AMDCheckpoint& Checkpoint)
 {
 	check(CheckpointsArray.Contains(&Checkpoint));
 
-	AMDCheckpoint* NewCurrentCheckpoint = &Checkpoint;
 	int32 CurIdx = CheckpointsArray.Find(&Checkpoint);
-	AMDCheckpoint* NewNextCheckpoint = (CheckpointsArray.Num() - 1) > CurIdx ? CheckpointsArray[CurIdx + 1].Get() : nullptr;
+	CheckpointTrackerComp.SetCurrentCheckpointIndex(CurIdx);
+
+	const double CrossingTime = GetCrossingRaceTime(CheckpointTrackerComp, Checkpoint);
+	CheckpointTrackerComp.TrySetSplitTime(CurIdx, CrossingTime);
 
-	CheckpointTrackerComp.SetCheckpoints(NewCurrentCheckpoint, NewNextCheckpoint);
+	if(Standings.IsValidIndex(CheckpointTrackerComp.RacePosition))
+	{
+		FMDRaceStanding& Standing = Standings[CheckpointTrackerComp.RacePosition];
+		Standing.CheckpointIndex = CurIdx;
+		UpdateStandingRemaining(Standing);
+		FixStandingPosition(CheckpointTrackerComp.RacePosition);
+	}
 
 	// We reached Goal, the end.
-	if(NewNextCheckpoint == nullptr)
+	if(CurIdx == CheckpointsArray.Num() - 1)
 	{
 		// Check if we can find PlayerState and if so, notify it. Could use Interface here, but since nobody else than MDCharacter would use it, no point.
 		if(const auto* MDCharacter = Cast<AMDCharacter>(CheckpointTrackerComp.GetOwner()))
 		{
 			if(auto* PS = MDCharacter->GetPlayerState<AMDPlayerState>())
 			{
-				PS->SetGoalIsReached();
+				PS->SetGoalIsReached(CrossingTime);
 			}
 		}
 	}
 }
 
+void UMDCheckpointSubsystem::OnTrackerMoved(UMDCheckpointTrackerComponent& CheckpointTrackerComp)
+{
+	if(Standings.IsValidIndex(CheckpointTrackerComp.RacePosition))
+	{
+		// Order changes only a little per move, so the standing usually stays put or swaps with a neighbour
+		FMDRaceStanding& Standing = Standings[CheckpointTrackerComp.RacePosition];
+		UpdateStandingRemaining(Standing);
+		FixStandingPosition(CheckpointTrackerComp.RacePosition);
+	}
+}
+
+void UMDCheckpointSubsystem::PredictTrackerOverlappedCheckpoint(UMDCheckpointTrackerComponent& CheckpointTrackerComp, AMDCheckpoint& Checkpoint)
+{
+	const int32 CurIdx = CheckpointsArray.Find(&Checkpoint);
+	if(CurIdx != INDEX_NONE)
+	{
+		CheckpointTrackerComp.PredictCurrentCheckpointIndex(CurIdx);
+	}
+}
+
+void UMDCheckpointSubsystem::ResetTracker(UMDCheckpointTrackerComponent& CheckpointTrackerComp)
+{
+	CheckpointTrackerComp.SetCurrentCheckpointIndex(INDEX_NONE);
+	CheckpointTrackerComp.ResetSplitTimes();
+
+	if(Standings.IsValidIndex(CheckpointTrackerComp.RacePosition))
+	{
+		FMDRaceStanding& Standing = Standings[CheckpointTrackerComp.RacePosition];
+		Standing.CheckpointIndex = INDEX_NONE;
+		UpdateStandingRemaining(Standing);
+		FixStandingPosition(CheckpointTrackerComp.RacePosition);
+	}
+}
+
+AMDCheckpoint* UMDCheckpointSubsystem::GetCheckpoint(int32 Index) const
+{
+	return CheckpointsArray.IsValidIndex(Index) ? CheckpointsArray[Index].Get() : nullptr;
+}
+
+void UMDCheckpointSubsystem::HighlightCheckpoints(int32 CurrentIndex)
+{
+	if(IsValid(Course))
+	{
+		Course->SetHighlightedCheckpoint(CurrentIndex);
+	}
+}
+
+void UMDCheckpointSubsystem::RebuildCourse()
+{
+	if(IsValid(Course))
+	{
+		Course->Rebuild(*this);
+	}
+}
+
 void UMDCheckpointSubsystem::SortCheckpoints()
 {
 	// Sort by descending order.
 	// First checkpoint is the highest one and the last is the lowest one.
+	// Server and clients must agree on the order, so equal heights are ordered by name, which is the same for actors loaded with the level.
 	CheckpointsArray.Sort([](const TWeakObjectPtr<AMDCheckpoint>& A, const TWeakObjectPtr<AMDCheckpoint>& B)
 	{
-		return A->GetActorLocation().Z > B->GetActorLocation().Z;
+		const double AZ = A->GetActorLocation().Z;
+		const double BZ = B->GetActorLocation().Z;
+		if(AZ != BZ)
+		{
+			return AZ > BZ;
+		}
+		return A->GetFName().LexicalLess(B->GetFName());
 	});
 }
 
+double UMDCheckpointSubsystem::GetCrossingRaceTime(const UMDCheckpointTrackerComponent& CheckpointTrackerComp, const AMDCheckpoint& Checkpoint) const
+{
+	const auto* MDCharacter = Cast<AMDCharacter>(CheckpointTrackerComp.GetOwner());
+	if(!IsValid(MDCharacter))
+	{
+		return 0.0;
+	}
+
+	const auto* MoveComp = CastChecked<UMDCharacterMovementComponent>(MDCharacter->GetCharacterMovement());
+	const auto* Capsule = MDCharacter->GetCapsuleComponent();
+	const FVector CapsuleExtent(Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+
+	// Overlaps are dispatched at the end of the move, so actor location is the end of the segment
+	const double Alpha = Checkpoint.ComputeEntryAlpha(MoveComp->GetMoveSegmentStartLocation(), MDCharacter->GetActorLocation(), CapsuleExtent);
+	return MoveComp->GetRaceClockAlongCurrentMove(Alpha);
+}
+
+void UMDCheckpointSubsystem::UpdateStandingRemaining(FMDRaceStanding& Standing) const
+{
+	const auto* Tracker = Standing.Tracker.Get();
+	const AActor* TrackerOwner = Tracker ? Tracker->GetOwner() : nullptr;
+	if(!IsValid(TrackerOwner))
+	{
+		return;
+	}
+
+	const AMDCheckpoint* NextCheckpoint = CheckpointsArray.IsValidIndex(Standing.CheckpointIndex + 1) ? CheckpointsArray[Standing.CheckpointIndex + 1].Get() : nullptr;
+	if(!IsValid(NextCheckpoint))
+	{
+		// Goal reached, finish time decides the order
+		Standing.Remaining = Tracker->GetSplitTime(Standing.CheckpointIndex);
+		return;
+	}
+
+	const FVector ToNext = NextCheckpoint->GetActorLocation() - TrackerOwner->GetActorLocation();
+	const AMDCheckpoint* CurrentCheckpoint = CheckpointsArray.IsValidIndex(Standing.CheckpointIndex) ? CheckpointsArray[Standing.CheckpointIndex].Get() : nullptr;
+	if(IsValid(CurrentCheckpoint))
+	{
+		// Project to the route between current and next checkpoint, moving sideways isn't progress
+		const FVector RouteDir = (NextCheckpoint->GetActorLocation() - CurrentCheckpoint->GetActorLocation()).GetSafeNormal();
+		Standing.Remaining = FVector::DotProduct(ToNext, RouteDir);
+	}
+	else
+	{
+		Standing.Remaining = ToNext.Size();
+	}
+}
+
+int32 UMDCheckpointSubsystem::FixStandingPosition(int32 Position)
+{
+	while(Position > 0 && Standings[Position].IsAheadOf(Standings[Position - 1]))
+	{
+		SwapStandings(Position, Position - 1);
+		--Position;
+	}
+	while(Position < Standings.Num() - 1 && Standings[Position + 1].IsAheadOf(Standings[Position]))
+	{
+		SwapStandings(Position, Position + 1);
+		++Position;
+	}
+	return Position;
+}
+
+void UMDCheckpointSubsystem::SwapStandings(int32 A, int32 B)
+{
+	Standings.Swap(A, B);
+	if(auto* TrackerA = Standings[A].Tracker.Get())
+	{
+		TrackerA->RacePosition = A;
+	}
+	if(auto* TrackerB = Standings[B].Tracker.Get())
+	{
+		TrackerB->RacePosition = B;
+	}
+	bStandingsOrderChanged = true;
+}
+
+void UMDCheckpointSubsystem::PublishStandings()
+{
+	if(!bStandingsOrderChanged)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if(LastStandingsPublishTime >= 0.0 && Now - LastStandingsPublishTime < StandingsReplicationInterval)
+	{
+		return;
+	}
+
+	auto* GS = GetWorld()->GetGameState<AMDGameStateBase>();
+	if(!IsValid(GS))
+	{
+		return;
+	}
+
+	TArray<int32> PlayerIds;
+	PlayerIds.Reserve(Standings.Num());
+	bool bAllHavePlayerState = true;
+	for(const auto& Standing : Standings)
+	{
+		const auto* Tracker = Standing.Tracker.Get();
+		const auto* Pawn = Tracker ? Cast<APawn>(Tracker->GetOwner()) : nullptr;
+		if(const auto* PS = Pawn ? Pawn->GetPlayerState() : nullptr)
+		{
+			PlayerIds.Add(PS->GetPlayerId());
+		}
+		else
+		{
+			bAllHavePlayerState = false;
+		}
+	}
+
+	GS->SetRaceStandings(MoveTemp(PlayerIds));
+	LastStandingsPublishTime = Now;
+	// PlayerState might not be replicated to the pawn yet, try again later if so
+	bStandingsOrderChanged = !bAllHavePlayerState;
+}
+
 bool UMDCheckpointSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
 {
 	// We only need this subsystem on Game worlds (PIE included)
@@ -7,17 +7,49 @@
 #include "MDCheckpointSubsystem.generated.h"
 
 class AMDCheckpoint;
+class AMDCheckpointCourse;
 class UMDCheckpointTrackerComponent;
 
+// Race progress of a single tracker. Subsystem keeps these sorted, leader first.
+struct FMDRaceStanding
+{
+	TWeakObjectPtr<UMDCheckpointTrackerComponent> Tracker;
+
+	// Index of the current checkpoint, INDEX_NONE if none reached yet
+	int32 CheckpointIndex = INDEX_NONE;
+
+	// Projected distance to the next checkpoint, or finish time if the goal is reached. Smaller is better.
+	double Remaining = 0.0;
+
+	bool IsAheadOf(const FMDRaceStanding& Other) const
+	{
+		if(CheckpointIndex != Other.CheckpointIndex)
+		{
+			return CheckpointIndex > Other.CheckpointIndex;
+		}
+		return Remaining < Other.Remaining;
+	}
+};
+
 /**
- * Server only WorldSubsystem that handles checkpoint related functionality.
- * 1. All MDCheckpoint actors register to this subsystem before BeginPlay.
- * 2. Checkpoints are sorted in descending order by their GetActorLocation Z value. Need to keep this in mind when designing the level or change SortCheckpoints() method.
+ * WorldSubsystem that handles checkpoint related functionality.
+ * 1. All MDCheckpoint actors register to this subsystem before BeginPlay, on server and clients.
+ * 2. Checkpoints are sorted in descending order by their GetActorLocation Z value, ties broken by actor name. Need to keep this in mind when designing the level or change SortCheckpoints() method.
+ *    Sorting only uses data loaded with the level, so server and clients end up with the same route and progress can be sent as an index into it.
  * 3. All MDCheckpointTrackerComponents register to this subsystem before BeginPlay.
- * 4. CheckpointSubsystem loops trough all TrackerComponents on tick to see if they have failed to reach next checkpoint and need to be reset to current checkpoint.
+ * 4. If a character falls below its next checkpoint, MDCharacterMovementComponent resets it to the current one as part of the move. Owning client predicts the reset and server repeats it when it receives the move.
  * 5. If CheckpointTracker overlaps with Checkpoint, set new Current and Next checkpoints. If there is no next checkpoint, assume that the goal is reached.
+ *    Owning client predicts the same for its own pawn, so the reset rule above uses the same checkpoints on both sides.
+ *    Server's result is authoritative, client takes it once server has processed the move that predicted its own (see MDCheckpointTrackerComponent.h).
+ * 6. Crossing time is interpolated inside the move that crossed the checkpoint (see UMDCharacterMovementComponent race clock), so split and finish times don't depend on server tick rate.
+ * 7. Live standings are kept sorted incrementally. A racer's standing is only updated after the server has performed one of its moves, and then moved to its new place by swapping with neighbours.
+ *    Racers that don't move cost nothing, and nobody is recomputed or sorted every frame.
+ *    Standings are published to MDGameStateBase as a list of PlayerIds, at most once per StandingsReplicationInterval and only if the order changed.
+ * 8. On clients the subsystem only holds the route and predicts progress for the local pawn. Tracker registration, ticking and standings are server only.
+ * 9. Where something is rendered, checkpoint meshes are drawn by a locally spawned MDCheckpointCourse with instanced static meshes (bRenderCheckpointsInstanced).
+ *    It also highlights the local player's current and next checkpoint.
  */
-UCLASS()
+UCLASS(Config = Game)
 class MOVEMENTDEMO_API UMDCheckpointSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
@@ -50,13 +82,63 @@ public:
 
 	void OnTrackerOverlappedCheckpoint(UMDCheckpointTrackerComponent& CheckpointTrackerComp, AMDCheckpoint& Checkpoint);
 
+	// Server only. Called by UMDCharacterMovementComponent after a move changed the tracker owner's location.
+	void OnTrackerMoved(UMDCheckpointTrackerComponent& CheckpointTrackerComp);
+
+	// Owning client only. Same progress rule as OnTrackerOverlappedCheckpoint, without split times, standings or goal.
+	void PredictTrackerOverlappedCheckpoint(UMDCheckpointTrackerComponent& CheckpointTrackerComp, AMDCheckpoint& Checkpoint);
+
+	// Clears checkpoints, split times and standing of the tracker. Called when player is restarted for a new match.
+	void ResetTracker(UMDCheckpointTrackerComponent& CheckpointTrackerComp);
+
+	int32 GetNumCheckpoints() const { return CheckpointsArray.Num(); }
+
+	// Checkpoint at given route index, nullptr if index is not valid.
+	AMDCheckpoint* GetCheckpoint(int32 Index) const;
+
+	const TArray<FMDRaceStanding>& GetStandings() const { return Standings; }
+
+	// Local player's progress, route index of the current checkpoint. Only changes how checkpoints are rendered.
+	void HighlightCheckpoints(int32 CurrentIndex);
+
 protected:
 
 	TArray<TWeakObjectPtr<AMDCheckpoint>> CheckpointsArray;
 
 	TArray<TWeakObjectPtr<UMDCheckpointTrackerComponent>> CheckpointTrackerCompArray;
 
+	// Sorted, leader first. Each tracker knows its own index in this array (RacePosition).
+	TArray<FMDRaceStanding> Standings;
+
+	UPROPERTY(Config)
+	float StandingsReplicationInterval = 0.5f;
+
+	bool bStandingsOrderChanged = false;
+
+	// Draw all checkpoints trough MDCheckpointCourse instead of one mesh per checkpoint actor
+	UPROPERTY(Config)
+	bool bRenderCheckpointsInstanced = true;
+
+	UPROPERTY(Transient)
+	AMDCheckpointCourse* Course;
+
+	double LastStandingsPublishTime = -1.0;
+
 	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
 
 	void SortCheckpoints();
+
+	void RebuildCourse();
+
+	void UpdateStandingRemaining(FMDRaceStanding& Standing) const;
+
+	// Moves standing at Position towards the front or back until it's in order. Returns new position.
+	int32 FixStandingPosition(int32 Position);
+
+	void SwapStandings(int32 A, int32 B);
+
+	void PublishStandings();
+
+	// Race clock of the moment the tracker's owner entered the checkpoint, interpolated along the move that crossed it.
+	double GetCrossingRaceTime(const UMDCheckpointTrackerComponent& CheckpointTrackerComp, const AMDCheckpoint& Checkpoint) const;
 };
@@ -5,57 +5,138 @@
 #include "MovementDemo/MDCheckpoint.h"
 #include "MovementDemo/MDCheckpointSubsystem.h"
 #include "MovementDemo/MDCharacter.h"
-#include "Net/UnrealNetwork.h"
-#include "Net/Core/PushModel/PushModel.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
+#include "Logging/StructuredLog.h"
 
 
 UMDCheckpointTrackerComponent::UMDCheckpointTrackerComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
-	SetIsReplicatedByDefault(true);
 }
 
-void UMDCheckpointTrackerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+void UMDCheckpointTrackerComponent::SetCurrentCheckpointIndex(int32 NewIndex)
 {
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	FDoRepLifetimeParams Params;
-	Params.bIsPushBased = true;
-	Params.Condition = COND_OwnerOnly;
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, CurrentCheckpoint, Params);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, NextCheckpoint, Params);
+	check(GetOwner()->HasAuthority());
+
+	if(!ApplyCheckpointIndex(NewIndex))
+	{
+		return;
+	}
+
+	// Owning client is the only one who needs these. Local player on listen server already has them.
+	if(auto* MDCharacter = Cast<AMDCharacter>(GetOwner()))
+	{
+		if(!MDCharacter->IsLocallyControlled() && MDCharacter->IsPlayerControlled())
+		{
+			// 0 means no checkpoint, so INDEX_NONE fits in the unsigned value
+			check(NewIndex < MAX_uint16);
+			const auto* MovementComponent = MDCharacter->GetCharacterMovement<UMDCharacterMovementComponent>();
+			MDCharacter->ClientSetCheckpointIndex(static_cast<uint16>(NewIndex + 1), MovementComponent->GetCurrentMoveTimeStamp());
+		}
+	}
 }
 
-void UMDCheckpointTrackerComponent::SetCheckpoints(AMDCheckpoint* Current, AMDCheckpoint* Next)
+void UMDCheckpointTrackerComponent::PredictCurrentCheckpointIndex(int32 NewIndex)
 {
-	check(GetOwner()->HasAuthority());
+	check(!GetOwner()->HasAuthority());
+
+	if(ApplyCheckpointIndex(NewIndex))
+	{
+		const auto* MovementComponent = CastChecked<AMDCharacter>(GetOwner())->GetCharacterMovement<UMDCharacterMovementComponent>();
+		CheckpointIndexTimeStamp = MovementComponent->GetCurrentMoveTimeStamp();
+	}
+}
 
-	if(CurrentCheckpoint == Current && NextCheckpoint == Next)
+void UMDCheckpointTrackerComponent::SetCurrentCheckpointIndexFromServer(int32 NewIndex, float ServerMoveTimeStamp)
+{
+	auto* MovementComponent = CastChecked<AMDCharacter>(GetOwner())->GetCharacterMovement<UMDCharacterMovementComponent>();
+	const float TimeStamp = MovementComponent->RebaseServerMoveTimeStamp(ServerMoveTimeStamp);
+
+	// Server hasn't seen the move that predicted our index yet, taking its older index would make us fall below the next checkpoint and reset.
+	// Once it has, its index wins, also when it never reached the checkpoint we predicted. Also drops corrections that arrive after newer RPCs.
+	if(TimeStamp < CheckpointIndexTimeStamp)
 	{
 		return;
 	}
 
+	ApplyCheckpointIndex(NewIndex);
+	CheckpointIndexTimeStamp = TimeStamp;
+
+	// Moves made after it are replayed with server's index, unless they predicted a newer one themselves
+	MovementComponent->ConfirmSavedMoveCheckpointIndex(NewIndex, TimeStamp);
+}
+
+void UMDCheckpointTrackerComponent::RestoreSavedMoveCheckpointIndex(int32 NewIndex, float NewIndexTimeStamp)
+{
+	ApplyCheckpointIndex(NewIndex);
+	CheckpointIndexTimeStamp = NewIndexTimeStamp;
+}
+
+bool UMDCheckpointTrackerComponent::ApplyCheckpointIndex(int32 NewIndex)
+{
+	auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>();
+	if(!ensure(CheckpointSubsystem))
+	{
+		return false;
+	}
+
+	auto* NewCurrentCheckpoint = CheckpointSubsystem->GetCheckpoint(NewIndex);
+	auto* NewNextCheckpoint = CheckpointSubsystem->GetCheckpoint(NewIndex + 1);
+	if(NewIndex != INDEX_NONE && !NewCurrentCheckpoint)
+	{
+		UE_LOGFMT(LogTemp, Warning, "{Name}: checkpoint index {Index} is not in the route of {Num} checkpoints.", GetNameSafe(GetOwner()), NewIndex, CheckpointSubsystem->GetNumCheckpoints());
+	}
+
+	// INDEX_NONE + 1 would resolve to the first checkpoint
+	if(NewIndex == INDEX_NONE)
+	{
+		NewNextCheckpoint = nullptr;
+	}
+
+	if(CurrentCheckpointIndex == NewIndex && CurrentCheckpoint == NewCurrentCheckpoint && NextCheckpoint == NewNextCheckpoint)
+	{
+		return false;
+	}
+
 	auto* OldCurrentCheckpoint = CurrentCheckpoint;
 	auto* OldNextCheckpoint = NextCheckpoint;
 
-	CurrentCheckpoint = Current;
-	NextCheckpoint = Next;
+	CurrentCheckpointIndex = NewIndex;
+	CurrentCheckpoint = NewCurrentCheckpoint;
+	NextCheckpoint = NewNextCheckpoint;
+
+	OnCheckpointsChanged(OldCurrentCheckpoint, OldNextCheckpoint);
+	return true;
+}
 
-	// If we are listen server, we need to call OnReps manually
-	if(GetNetMode() == NM_ListenServer)
+bool UMDCheckpointTrackerComponent::TrySetSplitTime(int32 CheckpointIndex, double RaceTime)
+{
+	check(GetOwner()->HasAuthority());
+	check(CheckpointIndex >= 0);
+
+	// Grow the array, unreached checkpoints are marked with negative time
+	while(!SplitTimes.IsValidIndex(CheckpointIndex))
 	{
-		// We need to figure if we are locally controlled, maybe there is cleaner way but this works. We only want to call these if our locally controlled is the owner.
-		if(const auto* MDCharacter = Cast<AMDCharacter>(GetOwner()))
-		{
-			if(MDCharacter->IsLocallyControlled())
-			{
-				OnRep_CurrentCheckpoint(OldCurrentCheckpoint);
-				OnRep_NextCheckpoint(OldNextCheckpoint);
-			}
-		}
+		SplitTimes.Add(-1.0);
 	}
 
-	MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, CurrentCheckpoint, this);
-	MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, NextCheckpoint, this);
+	if(SplitTimes[CheckpointIndex] >= 0.0)
+	{
+		return false;
+	}
+
+	SplitTimes[CheckpointIndex] = RaceTime;
+	return true;
+}
+
+double UMDCheckpointTrackerComponent::GetSplitTime(int32 CheckpointIndex) const
+{
+	return SplitTimes.IsValidIndex(CheckpointIndex) ? SplitTimes[CheckpointIndex] : -1.0;
+}
+
+void UMDCheckpointTrackerComponent::ResetSplitTimes()
+{
+	SplitTimes.Reset();
 }
 
 void UMDCheckpointTrackerComponent::BeginPlay()
@@ -84,10 +165,15 @@ void UMDCheckpointTrackerComponent::EndPlay(const EEndPlayReason::Type EndPlayRe
 	Super::EndPlay(EndPlayReason);
 }
 
-void UMDCheckpointTrackerComponent::OnRep_CurrentCheckpoint(AMDCheckpoint* OldCheckpoint)
-{
-}
-
-void UMDCheckpointTrackerComponent::OnRep_NextCheckpoint(AMDCheckpoint* OldCheckpoint)
+void UMDCheckpointTrackerComponent::OnCheckpointsChanged(AMDCheckpoint* OldCurrentCheckpoint, AMDCheckpoint* OldNextCheckpoint)
 {
+	// Show local player where to go
+	const auto* MDCharacter = Cast<AMDCharacter>(GetOwner());
+	if(MDCharacter && MDCharacter->IsLocallyControlled())
+	{
+		if(auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>())
+		{
+			CheckpointSubsystem->HighlightCheckpoints(CurrentCheckpointIndex);
+		}
+	}
 }
@@ -10,6 +10,13 @@ class AMDCheckpoint;
 
 /**
  * Keeps track of current and next checkpoints.
+ * Server also stores split times (race clock when each checkpoint was first reached) for the current match.
+ * Component is not replicated. Checkpoints change rarely, so server sends them to the owning client with a reliable RPC on MDCharacter only when they change.
+ * Progress is sent as an index into the checkpoint route, which the client resolves trough its own MDCheckpointSubsystem. Next checkpoint is always the one after current.
+ * Owning client predicts progress from its own overlaps, so fall-off resets in MDCharacterMovementComponent don't wait for the server.
+ * Index is tagged with the client move it comes from and saved with every move, so replays reset to the checkpoint the move was made with.
+ * Server sends its index with the last client move it has processed, also with every correction. Client takes it if that move is not older than the one ours comes from,
+ * so a checkpoint server never reached is corrected, but its older answers don't undo newer predictions.
  * See MDCheckpointSubsystem.h for overview of checkpoint system.
  */
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
@@ -21,29 +28,73 @@ public:
 
 	UMDCheckpointTrackerComponent();
 
-	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// Server only. Index into MDCheckpointSubsystem route, INDEX_NONE clears checkpoints. Notifies owning client if anything changed.
+	void SetCurrentCheckpointIndex(int32 NewIndex);
 
-	void SetCheckpoints(AMDCheckpoint* Current, AMDCheckpoint* Next);
+	// Owning client only. Called when local pawn overlaps a checkpoint, before server confirms it.
+	void PredictCurrentCheckpointIndex(int32 NewIndex);
+
+	// Owning client only. Called by AMDCharacter::ClientSetCheckpointIndex and with corrections, ServerMoveTimeStamp is the last client move server has processed.
+	// Ignored if server hasn't processed the move our index comes from yet.
+	void SetCurrentCheckpointIndexFromServer(int32 NewIndex, float ServerMoveTimeStamp);
+
+	// Owning client only. Puts back the index a saved move was made with, before the move is replayed.
+	void RestoreSavedMoveCheckpointIndex(int32 NewIndex, float NewIndexTimeStamp);
+
+	// Owning client only. Client timestamps were reset, see FMDNetworkPredictionData_Client::UpdateTimeStampAndDeltaTime.
+	void RebaseCheckpointIndexTimeStamp(float Offset) { CheckpointIndexTimeStamp -= Offset; }
+
+	int32 GetCurrentCheckpointIndex() const { return CurrentCheckpointIndex; }
+
+	// Owning client only. Client move current index comes from, either the one that predicted it or the last one server had processed when sending it.
+	float GetCheckpointIndexTimeStamp() const { return CheckpointIndexTimeStamp; }
 
 	AMDCheckpoint* GetCurrentCheckpoint() const { return CurrentCheckpoint; }
 
 	AMDCheckpoint* GetNextCheckpoint() const { return NextCheckpoint; }
 
+	// Only stores the time if the checkpoint wasn't reached yet during this match. Returns true if time was stored.
+	bool TrySetSplitTime(int32 CheckpointIndex, double RaceTime);
+
+	// Returns negative value if the checkpoint hasn't been reached during this match.
+	double GetSplitTime(int32 CheckpointIndex) const;
+
+	const TArray<double>& GetSplitTimes() const { return SplitTimes; }
+
+	void ResetSplitTimes();
+
+	// Index in UMDCheckpointSubsystem standings, 0 is the leader. Server only.
+	int32 GetRacePosition() const { return RacePosition; }
+
 protected:
 
-	UPROPERTY(ReplicatedUsing = OnRep_CurrentCheckpoint)
+	int32 CurrentCheckpointIndex = INDEX_NONE;
+
+	// Lowest value until we have an index, so server's first one is always taken
+	float CheckpointIndexTimeStamp = TNumericLimits<float>::Lowest();
+
+	// Resolved from CurrentCheckpointIndex
+	UPROPERTY()
 	AMDCheckpoint* CurrentCheckpoint;
 
-	UPROPERTY(ReplicatedUsing = OnRep_NextCheckpoint)
+	UPROPERTY()
 	AMDCheckpoint* NextCheckpoint;
 
+	// Server only, indexed by checkpoint index.
+	TArray<double> SplitTimes;
+
+	// Managed by UMDCheckpointSubsystem
+	int32 RacePosition = INDEX_NONE;
+
 	virtual void BeginPlay() override;
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	UFUNCTION()
-	void OnRep_CurrentCheckpoint(AMDCheckpoint* OldCheckpoint);
+	// Resolves checkpoints for the index. Returns false if nothing changed.
+	bool ApplyCheckpointIndex(int32 NewIndex);
+
+	// Called on server and owning client
+	void OnCheckpointsChanged(AMDCheckpoint* OldCurrentCheckpoint, AMDCheckpoint* OldNextCheckpoint);
 
-	UFUNCTION()
-	void OnRep_NextCheckpoint(AMDCheckpoint* OldCheckpoint);
+	friend class UMDCheckpointSubsystem;
 };
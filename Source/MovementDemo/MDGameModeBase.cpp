@@ -4,10 +4,10 @@
 #include "MovementDemo/MDGameModeBase.h"
 #include "MovementDemo/MDGameStateBase.h"
 #include "MovementDemo/MDPlayerState.h"
+#include "MovementDemo/MDCharacter.h"
 #include "MovementDemo/MDCharacterMovementComponent.h"
-#include "EngineUtils.h"
-#include "Engine/PlayerStartPIE.h"
-#include "Components/CapsuleComponent.h"
+#include "MovementDemo/MDCheckpointSubsystem.h"
+#include "MovementDemo/MDLeaderboardSubsystem.h"
 #include "GameFramework/PlayerStart.h"
 #include "GameFramework/Character.h"
 #include "GameFramework/GameSession.h"
@@ -20,9 +20,15 @@ AMDGameModeBase::AMDGameModeBase()
 {
 }
 
-void AMDGameModeBase::PostLogin(APlayerController* NewPlayer)
+void AMDGameModeBase::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
 {
-	Super::PostLogin(NewPlayer);
+	if(AdmissionPolicy == EMDAdmissionPolicy::AdmitAtMatchBoundary && HasPlayersInMatch(NewPlayer))
+	{
+		QueueForAdmission(NewPlayer);
+		return;
+	}
+
+	Super::HandleStartingNewPlayer_Implementation(NewPlayer);
 
 	// Start new match when new player joins
 	BeginMatchReset();
@@ -31,84 +37,44 @@ void AMDGameModeBase::PostLogin(APlayerController* NewPlayer)
 	ResetWins();
 }
 
-AActor* AMDGameModeBase::ChoosePlayerStart_Implementation(AController* Player)
+void AMDGameModeBase::Logout(AController* Exiting)
 {
-	APlayerStart* FoundPlayerStart = nullptr;
-	UClass* PawnClass = GetDefaultPawnClassForController(Player);
-	APawn* PawnToFit = PawnClass ? PawnClass->GetDefaultObject<APawn>() : nullptr;
-	TArray<APlayerStart*> UnOccupiedStartPoints;
-	TArray<APlayerStart*> OccupiedStartPoints;
-	UWorld* World = GetWorld();
+	auto* ExitingPC = Cast<APlayerController>(Exiting);
+	AdmissionQueue.Remove(ExitingPC);
+	SpawnSlots.ReleaseSlot(Exiting);
 
-	// Since we have disable collision between players, default implementation will spawn players top of each other and we need to change the logic
-	// We will loops trough all existing players and check that our starting spot has minimum distance to other players
-	// This should always work, if we have more starting spots than players
-	TArray<FVector> ExistingPlayerLocations;
+	Super::Logout(Exiting);
 
-	for(const APawn* Pawn : TActorRange<APawn>(World, PawnClass))
+	// Last racer left, nobody is going to finish the match for the waiting players
+	if(AdmissionQueue.Num() > 0 && !HasPlayersInMatch(ExitingPC))
 	{
-		ExistingPlayerLocations.Add(Pawn->GetActorLocation());
+		BeginMatchReset();
 	}
+}
 
-	//If pawn has capsule minimum distance will be capsule radius + a bit more, otherwise we will use hard coded value
-	double MinDistanceSquared = FMath::Square(100.0);
+void AMDGameModeBase::StartPlay()
+{
+	EnsureSpawnSlots();
 
-	if(const auto* Capsule = PawnToFit->GetComponentByClass<UCapsuleComponent>())
-	{
-		MinDistanceSquared = FMath::Square(Capsule->GetScaledCapsuleRadius() + 5.0);
-	}
+	Super::StartPlay();
 
-	for(auto* PlayerStart : TActorRange<APlayerStart>(World))
+	// We run many server processes per host, log what this one costs so server and game targets can be compared
+	static bool bHasLoggedStartup = false;
+	if(IsNetMode(NM_DedicatedServer) && !bHasLoggedStartup)
 	{
-		if (PlayerStart->IsA<APlayerStartPIE>())
-		{
-			// Always prefer the first "Play from Here" PlayerStart, if we find one while in PIE mode
-			FoundPlayerStart = PlayerStart;
-			break;
-		}
-
-		FVector StartLocation = PlayerStart->GetActorLocation();
-		FRotator StartRotation = PlayerStart->GetActorRotation();
-
-		bool bShouldSkipThisPlayerStart = false;
-		for(const auto& NoGoLocation : ExistingPlayerLocations)
-		{
-			// We will use horizontal distance here, might not work for all games, but works for our game
-			if (FVector::DistSquaredXY(StartLocation, NoGoLocation) < MinDistanceSquared)
-			{
-				bShouldSkipThisPlayerStart = true;
-				break;
-			}
-		}
-
-		if(bShouldSkipThisPlayerStart)
-		{
-			continue;
-		}
-
-		// Do some additional collision checks copy pasted from Super
-		if (!World->EncroachingBlockingGeometry(PawnToFit, StartLocation, StartRotation))
-		{
-			UnOccupiedStartPoints.Add(PlayerStart);
-		}
-		else if (World->FindTeleportSpot(PawnToFit, StartLocation, StartRotation))
-		{
-			OccupiedStartPoints.Add(PlayerStart);
-		}
+		bHasLoggedStartup = true;
+		const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+		UE_LOGFMT(LogTemp, Display, "Dedicated server ready in {Seconds} s. Resident memory {UsedMB} MB, peak {PeakMB} MB.",
+			FPlatformTime::Seconds() - GStartTime, MemoryStats.UsedPhysical / (1024 * 1024), MemoryStats.PeakUsedPhysical / (1024 * 1024));
 	}
+}
 
-	if (FoundPlayerStart == nullptr)
-	{
-		if (UnOccupiedStartPoints.Num() > 0)
-		{
-			FoundPlayerStart = UnOccupiedStartPoints[FMath::RandRange(0, UnOccupiedStartPoints.Num() - 1)];
-		}
-		else if (OccupiedStartPoints.Num() > 0)
-		{
-			FoundPlayerStart = OccupiedStartPoints[FMath::RandRange(0, OccupiedStartPoints.Num() - 1)];
-		}
-	}
-	return FoundPlayerStart;
+AActor* AMDGameModeBase::ChoosePlayerStart_Implementation(AController* Player)
+{
+	// Since we have disabled collision between players, default implementation would spawn players on top of each other.
+	// Every player has its own slot instead, start spots were validated when the slots were built.
+	EnsureSpawnSlots();
+	return SpawnSlots.GetOrAssignSlot(Player);
 }
 
 void AMDGameModeBase::RestartPlayerAtPlayerStart(AController* NewPlayer, AActor* StartSpot)
@@ -181,6 +147,10 @@ void AMDGameModeBase::SetMatchState(EMDMatchState NewState)
 		case EMDMatchState::OnGoing:
 		{
 			OnStartingShot();
+			if(AdmissionQueue.Num() > 0)
+			{
+				StartMaxAdmissionWait();
+			}
 			break;
 		}
 		default:
@@ -188,12 +158,30 @@ void AMDGameModeBase::SetMatchState(EMDMatchState NewState)
 	}
 }
 
-void AMDGameModeBase::TryGiveWinToPlayer(AMDPlayerState* PlayerState)
+void AMDGameModeBase::TryGiveWinToPlayer(AMDPlayerState* PlayerState, double TimeCompleted)
 {
-	if (!bHasWinBeenAssignedThisMatch)
+	if (MatchWinningTime >= 0.0 && TimeCompleted >= MatchWinningTime)
+	{
+		return;
+	}
+
+	// Someone crossed earlier than the current winner, but their move arrived later. Take the win back.
+	auto* Leaderboard = GetWorld()->GetSubsystem<UMDLeaderboardSubsystem>();
+	if (auto* PreviousWinner = MatchWinner.Get())
+	{
+		PreviousWinner->SetWinCount(FMath::Max(0, PreviousWinner->GetWinCount() - 1));
+		if (Leaderboard)
+		{
+			Leaderboard->ReportWins(*PreviousWinner, -1);
+		}
+	}
+
+	MatchWinner = PlayerState;
+	MatchWinningTime = TimeCompleted;
+	PlayerState->SetWinCount(PlayerState->GetWinCount() + 1);
+	if (Leaderboard)
 	{
-		bHasWinBeenAssignedThisMatch = true;
-		PlayerState->SetWinCount(PlayerState->GetWinCount() + 1);
+		Leaderboard->ReportWins(*PlayerState, 1);
 	}
 }
 
@@ -230,6 +218,15 @@ FString AMDGameModeBase::InitNewPlayer(APlayerController* NewPlayerController, c
 
 	ChangeName(NewPlayerController, InName, false);
 
+	// Returning player gets their best time back. Unique id was set by RegisterPlayer above.
+	if (auto* Leaderboard = GetWorld()->GetSubsystem<UMDLeaderboardSubsystem>())
+	{
+		if (auto* MDPlayerState = NewPlayerController->GetPlayerState<AMDPlayerState>())
+		{
+			Leaderboard->RestorePlayer(*MDPlayerState);
+		}
+	}
+
 	return ErrorMessage;
 }
 
@@ -238,6 +235,72 @@ void AMDGameModeBase::BeginMatchReset()
 	SetMatchState(EMDMatchState::WaitingMatchReset);
 }
 
+bool AMDGameModeBase::HasPlayersInMatch(const APlayerController* Ignored) const
+{
+	for(const auto& Player : GameState->PlayerArray)
+	{
+		if(!Player->IsSpectator() && Player->GetPlayerController() != Ignored)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void AMDGameModeBase::QueueForAdmission(APlayerController* PC)
+{
+	UE_LOGFMT(LogTemp, Log, "{0} is waiting for the next match.", PC->PlayerState->GetPlayerName());
+
+	// Same as spectators in AGameMode
+	PC->PlayerState->SetIsSpectator(true);
+	PC->ChangeState(NAME_Spectating);
+	PC->ClientGotoState(NAME_Spectating);
+	AdmissionQueue.Add(PC);
+
+	// Players queued before the starting shot get the timer when the match starts
+	if(MatchState == EMDMatchState::OnGoing)
+	{
+		StartMaxAdmissionWait();
+	}
+}
+
+void AMDGameModeBase::StartMaxAdmissionWait()
+{
+	// Don't let a long match keep players waiting forever. Only one reset per batch of waiting players.
+	if(MaxAdmissionWait > 0.0f && !GetWorldTimerManager().IsTimerActive(TimerHandle_MaxAdmissionWait))
+	{
+		FTimerDelegate TimerDelegate;
+		TimerDelegate.BindWeakLambda(this, [this]()
+			{
+				if(MatchState == EMDMatchState::OnGoing && AdmissionQueue.Num() > 0)
+				{
+					BeginMatchReset();
+				}
+			});
+		GetWorldTimerManager().SetTimer(TimerHandle_MaxAdmissionWait, TimerDelegate, MaxAdmissionWait, false);
+	}
+}
+
+bool AMDGameModeBase::AdmitQueuedPlayers()
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_MaxAdmissionWait);
+
+	bool bAdmittedAny = false;
+	for(auto& QueuedPC : AdmissionQueue)
+	{
+		if(auto* PC = QueuedPC.Get())
+		{
+			PC->PlayerState->SetIsSpectator(false);
+			PC->ChangeState(NAME_Playing);
+			PC->ClientGotoState(NAME_Playing);
+			bAdmittedAny = true;
+		}
+	}
+	AdmissionQueue.Reset();
+
+	return bAdmittedAny;
+}
+
 void AMDGameModeBase::StartCountdownToMatchReset()
 {
 	FTimerDelegate TimerDelegate;
@@ -250,16 +313,27 @@ void AMDGameModeBase::StartCountdownToMatchReset()
 
 void AMDGameModeBase::StartCountdownToStartingShot()
 {
-	for(auto& Player: GameState->PlayerArray)
+	// Everyone who joined during the last match gets in at once, so the match is reset only once no matter how many joined
+	if(AdmitQueuedPlayers() && bResetWinsOnAdmission)
 	{
-		auto* MDPLayerState = CastChecked<AMDPlayerState>(Player);
-		MDPLayerState->ResetHasReachedGoal();
-		auto* PC = Player->GetPlayerController();
-		RestartPlayer(PC);
-		RootPlayer(PC);
+		ResetWins();
 	}
 
 	auto* GS = GetGameState<AMDGameStateBase>();
+	// One event for everyone instead of updating every PlayerState
+	GS->NotifyMatchReset();
+
+	// Spread teleports and start spot selection over the countdown instead of doing everyone in one frame
+	PendingPlayerResets.Reset();
+	for(auto& Player: GameState->PlayerArray)
+	{
+		if(!Player->IsSpectator())
+		{
+			PendingPlayerResets.Add(Player->GetPlayerController());
+		}
+	}
+	ProcessPendingPlayerResets();
+
 	GS->SetStartingShotTime(GetWorld()->TimeSeconds + StartingShotDelay);
 
 	FTimerDelegate TimerDelegate;
@@ -270,15 +344,65 @@ void AMDGameModeBase::StartCountdownToStartingShot()
 	GetWorldTimerManager().SetTimer(TimerHandle_StartingShot, TimerDelegate, StartingShotDelay, false);
 }
 
+void AMDGameModeBase::ProcessPendingPlayerResets()
+{
+	int32 NumProcessed = 0;
+	while(PendingPlayerResets.Num() > 0 && NumProcessed < MaxPlayerResetsPerFrame)
+	{
+		// Keep join order, list is short anyway
+		auto* PC = PendingPlayerResets[0].Get();
+		PendingPlayerResets.RemoveAt(0, 1, false);
+
+		// Player might have left while waiting
+		if(IsValid(PC))
+		{
+			ResetPlayerForNewMatch(PC);
+			++NumProcessed;
+		}
+	}
+
+	if(PendingPlayerResets.Num() > 0)
+	{
+		TimerHandle_PlayerResets = GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::ProcessPendingPlayerResets);
+	}
+}
+
+void AMDGameModeBase::ResetPlayerForNewMatch(APlayerController* PC)
+{
+	const auto* MDCharacter = Cast<AMDCharacter>(PC->GetCharacter());
+	auto* CheckpointSubsystem = GetWorld()->GetSubsystem<UMDCheckpointSubsystem>();
+	if (MDCharacter && CheckpointSubsystem)
+	{
+		CheckpointSubsystem->ResetTracker(*MDCharacter->GetCheckpointTrackerComp());
+	}
+	RestartPlayer(PC);
+	RootPlayer(PC);
+}
+
 void AMDGameModeBase::OnStartingShot()
 {
+	// Countdown was too short for the budget, finish everyone before they are released
+	if(PendingPlayerResets.Num() > 0)
+	{
+		GetWorldTimerManager().ClearTimer(TimerHandle_PlayerResets);
+		for(auto& PendingPC : PendingPlayerResets)
+		{
+			if(auto* PC = PendingPC.Get())
+			{
+				ResetPlayerForNewMatch(PC);
+			}
+		}
+		PendingPlayerResets.Reset();
+	}
+
 	for (auto& Player : GameState->PlayerArray)
 	{
 		auto* PC = Player->GetPlayerController();
 		UnRootPlayer(PC);
 	}
 
-	bHasWinBeenAssignedThisMatch = false;
+	MatchWinner.Reset();
+	MatchWinningTime = -1.0;
 }
 
 void AMDGameModeBase::RootPlayer(APlayerController* PC)
@@ -286,8 +410,9 @@ void AMDGameModeBase::RootPlayer(APlayerController* PC)
 	if(auto* Character = PC->GetCharacter())
 	{
 		auto* MoveComp = Character->GetCharacterMovement();
+		// No ForceNetUpdate here, teleport and movement mode replicate with the next regular update during countdown
 		MoveComp->SetMovementMode(MOVE_Custom, MDMOVE_Rooted);
-		Character->ForceNetUpdate();
+		CastChecked<AMDCharacter>(Character)->UpdateNetUpdateState();
 	}
 }
 
@@ -295,17 +420,35 @@ void AMDGameModeBase::UnRootPlayer(APlayerController* PC)
 {
 	if (auto* Character = PC->GetCharacter())
 	{
-		auto* MoveComp = Character->GetCharacterMovement();
+		auto* MoveComp = CastChecked<UMDCharacterMovementComponent>(Character->GetCharacterMovement());
 		MoveComp->SetMovementMode(MOVE_Walking);
+		// Race times are measured from this moment
+		MoveComp->ResetRaceClock();
+		CastChecked<AMDCharacter>(Character)->UpdateNetUpdateState();
 		Character->ForceNetUpdate();
 	}
 }
 
+void AMDGameModeBase::EnsureSpawnSlots()
+{
+	// Local player on listen server can be restarted before StartPlay
+	if(!SpawnSlots.IsBuilt())
+	{
+		const APawn* PawnToFit = DefaultPawnClass ? DefaultPawnClass->GetDefaultObject<APawn>() : nullptr;
+		SpawnSlots.Build(*GetWorld(), PawnToFit);
+	}
+}
+
 void AMDGameModeBase::ResetWins()
 {
+	// Leaderboard keeps all time wins of returning players, those are not reset
+	auto* Leaderboard = GetWorld()->GetSubsystem<UMDLeaderboardSubsystem>();
 	for (auto& Player : GameState->PlayerArray)
 	{
 		auto* MDPLayerState = CastChecked<AMDPlayerState>(Player);
-		MDPLayerState->SetWinCount(0);
+		if (!Leaderboard || !Leaderboard->IsTrackingPlayer(*MDPLayerState))
+		{
+			MDPLayerState->SetWinCount(0);
+		}
 	}
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "MovementDemo/MDSpawnSlotAllocator.h"
 #include "MDGameModeBase.generated.h"
 
 class AMDPlayerState;
@@ -16,10 +17,19 @@ enum class EMDMatchState : uint8
 	OnGoing, // Match is in progress
 };
 
+UENUM()
+enum class EMDAdmissionPolicy : uint8
+{
+	ResetMatchOnJoin, // every join restarts the match right away
+	AdmitAtMatchBoundary, // joining players spectate until the next match is set up, then everyone waiting is admitted at once
+};
+
 /**
  * MDGameModeBase takes care of flow of the game server side.
- * We start new match and reset wins when new player joins.
+ * New players wait as spectators in the admission queue and are admitted together when the next match is set up, see EMDAdmissionPolicy.
+ * First player to join starts a match right away.
  * We then wait for any player to reach the end and restart the match and loop this forever.
+ * Players are moved to start spots in small batches during the starting shot countdown, to avoid a spike when everyone is teleported in one frame.
  */
 
 UCLASS()
@@ -31,7 +41,9 @@ public:
 
 	AMDGameModeBase();
 
-	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+
+	virtual void StartPlay() override;
 
 	virtual AActor* ChoosePlayerStart_Implementation(AController* Player) override;
 
@@ -41,7 +53,8 @@ public:
 
 	void SetMatchState(EMDMatchState NewState);
 
-	void TryGiveWinToPlayer(AMDPlayerState* PlayerState);
+	// Win goes to the fastest finisher of the match. Finishes are processed in the order their moves arrive, so a later finisher can still take the win.
+	void TryGiveWinToPlayer(AMDPlayerState* PlayerState, double TimeCompleted);
 
 protected:
 
@@ -51,7 +64,9 @@ protected:
 
 	EMDMatchState MatchState;
 
-	bool bHasWinBeenAssignedThisMatch = false;
+	TWeakObjectPtr<AMDPlayerState> MatchWinner;
+
+	double MatchWinningTime = -1.0;
 
 	UPROPERTY(EditAnywhere)
 	float MatchResetDelay = 5.0f;
@@ -59,21 +74,67 @@ protected:
 	UPROPERTY(EditAnywhere)
 	float StartingShotDelay = 3.0f;
 
+	// Players are moved to their start spots over multiple frames during the starting shot countdown, this many per frame.
+	UPROPERTY(EditAnywhere, meta = (ClampMin = "1", UIMin = "1"))
+	int32 MaxPlayerResetsPerFrame = 4;
+
+	UPROPERTY(EditAnywhere, Category = "Admission")
+	EMDAdmissionPolicy AdmissionPolicy = EMDAdmissionPolicy::AdmitAtMatchBoundary;
+
+	// If nobody finishes the match in this time, match is reset so waiting players get in. 0 means wait for the match to end.
+	UPROPERTY(EditAnywhere, Category = "Admission", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "s"))
+	float MaxAdmissionWait = 30.0f;
+
+	// Reset wins of everyone when new players are admitted
+	UPROPERTY(EditAnywhere, Category = "Admission")
+	bool bResetWinsOnAdmission = true;
+
+	TArray<TWeakObjectPtr<APlayerController>> AdmissionQueue;
+
+	FTimerHandle TimerHandle_MaxAdmissionWait;
+
+	TArray<TWeakObjectPtr<APlayerController>> PendingPlayerResets;
+
+	FTimerHandle TimerHandle_PlayerResets;
+
 	int32 NextPlayerNumber = 1;
 
+	FMDSpawnSlotAllocator SpawnSlots;
+
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+
 	virtual FString InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal = TEXT("")) override;
 
 	void BeginMatchReset();
 
+	bool HasPlayersInMatch(const APlayerController* Ignored = nullptr) const;
+
+	// Holds the player as spectator until the next match is set up
+	void QueueForAdmission(APlayerController* PC);
+
+	// Resets the match after MaxAdmissionWait if the admission queue is still waiting on an ongoing match
+	void StartMaxAdmissionWait();
+
+	// Lets everyone in the admission queue to play. Returns true if anyone was admitted.
+	bool AdmitQueuedPlayers();
+
 	void StartCountdownToMatchReset();
 
 	void StartCountdownToStartingShot();
 
 	void OnStartingShot();
 
+	// Resets at most MaxPlayerResetsPerFrame players and schedules itself for next frame if there are more left.
+	void ProcessPendingPlayerResets();
+
+	void ResetPlayerForNewMatch(APlayerController* PC);
+
 	void RootPlayer(APlayerController* PC);
 
 	void UnRootPlayer(APlayerController* PC);
 
+	// Players tracked by UMDLeaderboardSubsystem keep their all time wins
 	void ResetWins();
+
+	void EnsureSpawnSlots();
 };
@@ -2,12 +2,14 @@
 
 
 #include "MovementDemo/MDGameStateBase.h"
+#include "MovementDemo/MDPlayerState.h"
 #include "Logging/StructuredLog.h"
 #include "Net/UnrealNetwork.h"
 #include "Net/Core/PushModel/PushModel.h"
 
 AMDGameStateBase::AMDGameStateBase()
 {
+	Scoreboard.OwningGameState = this;
 }
 
 void AMDGameStateBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -16,6 +18,24 @@ void AMDGameStateBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 	FDoRepLifetimeParams Params;
 	Params.bIsPushBased = true;
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, StartingShotServerTime, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, RaceStandings, Params);
+
+	// Fast array keeps track of its own changes
+	DOREPLIFETIME(ThisClass, Scoreboard);
+}
+
+void AMDGameStateBase::RemovePlayerState(APlayerState* PlayerState)
+{
+	if(HasAuthority() && PlayerState)
+	{
+		Scoreboard.RemoveEntry(PlayerState->GetPlayerId());
+	}
+	else if(PlayerState)
+	{
+		ScoreboardPlayersById.Remove(PlayerState->GetPlayerId());
+	}
+
+	Super::RemovePlayerState(PlayerState);
 }
 
 void AMDGameStateBase::SetStartingShotTime(double Time)
@@ -31,7 +51,80 @@ void AMDGameStateBase::SetStartingShotTime(double Time)
 	}
 }
 
+void AMDGameStateBase::SetRaceStandings(TArray<int32>&& PlayerIds)
+{
+	if(HasAuthority() && RaceStandings != PlayerIds)
+	{
+		RaceStandings = MoveTemp(PlayerIds);
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, RaceStandings, this);
+
+		// Call OnRep manually on Server
+		OnRep_RaceStandings();
+	}
+}
+
+void AMDGameStateBase::UpdateScoreboardEntry(const AMDPlayerState& PlayerState)
+{
+	if(!HasAuthority())
+	{
+		return;
+	}
+
+	FMDScoreboardEntry& Entry = Scoreboard.FindOrAddEntry(PlayerState.GetPlayerId());
+	Entry.BestTimeMs = FMDScoreboardEntry::QuantizeTime(PlayerState.GetBestCompletedTime());
+	Entry.LastTimeMs = FMDScoreboardEntry::QuantizeTime(PlayerState.GetLastCompletedTime());
+	Entry.Wins = static_cast<uint16>(FMath::Clamp(PlayerState.GetWinCount(), 0, MAX_uint16));
+	Entry.bHasReachedGoal = PlayerState.HasReachedGoal();
+	Scoreboard.MarkItemDirty(Entry);
+}
+
+void AMDGameStateBase::OnScoreboardEntryReplicated(const FMDScoreboardEntry& Entry)
+{
+	// PlayerState might not be replicated yet. If so, it will pick up the entry in its BeginPlay.
+	if(auto* MDPlayerState = ScoreboardPlayersById.FindRef(Entry.PlayerId).Get())
+	{
+		MDPlayerState->ApplyScoreboardEntry(Entry);
+	}
+}
+
+void AMDGameStateBase::RegisterScoreboardPlayer(AMDPlayerState& PlayerState)
+{
+	ScoreboardPlayersById.Add(PlayerState.GetPlayerId(), &PlayerState);
+}
+
+void AMDGameStateBase::NotifyMatchReset()
+{
+	if(HasAuthority())
+	{
+		// Runs on server too
+		MulticastMatchReset();
+	}
+}
+
 void AMDGameStateBase::OnRep_StartingShotServerTime()
 {
 
 }
+
+void AMDGameStateBase::OnRep_RaceStandings()
+{
+	RacePositionByPlayerId.Reset();
+	for(int32 Position = 0; Position < RaceStandings.Num(); ++Position)
+	{
+		RacePositionByPlayerId.Add(RaceStandings[Position], Position);
+	}
+}
+
+void AMDGameStateBase::MulticastMatchReset_Implementation()
+{
+	// Server and clients both clear the flags, so entries are not marked dirty here
+	Scoreboard.ClearReachedGoalFlags();
+
+	for(auto& Player : PlayerArray)
+	{
+		if(auto* MDPlayerState = Cast<AMDPlayerState>(Player))
+		{
+			MDPlayerState->ClearHasReachedGoalForMatchReset();
+		}
+	}
+}
@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameStateBase.h"
+#include "MovementDemo/MDScoreboard.h"
 #include "MDGameStateBase.generated.h"
 
+class AMDPlayerState;
+
 /**
  * MDGameStateBase contains shared replicated data that needs to be available for all clients.
  */
@@ -20,15 +23,63 @@ public:
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	virtual void RemovePlayerState(APlayerState* PlayerState) override;
+
 	void SetStartingShotTime(double Time);
 
 	double GetStartingShotServerTime() const { return StartingShotServerTime; }
 
+	// Ordered PlayerIds, leader first. Set by UMDCheckpointSubsystem.
+	void SetRaceStandings(TArray<int32>&& PlayerIds);
+
+	const TArray<int32>& GetRaceStandings() const { return RaceStandings; }
+
+	// Returns INDEX_NONE if the player is not racing.
+	int32 GetRacePosition(int32 PlayerId) const
+	{
+		const int32* Position = RacePositionByPlayerId.Find(PlayerId);
+		return Position ? *Position : INDEX_NONE;
+	}
+
+	// Server only. Copies stats from the PlayerState to its scoreboard entry.
+	void UpdateScoreboardEntry(const AMDPlayerState& PlayerState);
+
+	const FMDScoreboardEntry* FindScoreboardEntry(int32 PlayerId) const { return Scoreboard.FindEntry(PlayerId); }
+
+	// Called by scoreboard entries when they are added or changed on clients.
+	void OnScoreboardEntryReplicated(const FMDScoreboardEntry& Entry);
+
+	// Clients only. Called from AMDPlayerState::BeginPlay, when PlayerId has been replicated.
+	void RegisterScoreboardPlayer(AMDPlayerState& PlayerState);
+
+	// Server only. Single event telling everyone that a new match is being set up.
+	// Everyone clears goal reached flags locally, so scoreboard entries don't need to be sent for it.
+	void NotifyMatchReset();
+
 protected:
 
 	UPROPERTY(ReplicatedUsing = OnRep_StartingShotServerTime)
 	double StartingShotServerTime = -1.0;
 
+	UPROPERTY(ReplicatedUsing = OnRep_RaceStandings)
+	TArray<int32> RaceStandings;
+
+	// Index of each PlayerId in RaceStandings. Rebuilt when standings change, so lookups per racer per frame stay cheap.
+	TMap<int32, int32> RacePositionByPlayerId;
+
+	UPROPERTY(Replicated)
+	FMDScoreboard Scoreboard;
+
+	// PlayerStates that scoreboard entries are applied to, so a delta touching every entry doesn't scan PlayerArray for each
+	TMap<int32, TWeakObjectPtr<AMDPlayerState>> ScoreboardPlayersById;
+
 	UFUNCTION()
 	void OnRep_StartingShotServerTime();
+
+	UFUNCTION()
+	void OnRep_RaceStandings();
+
+	// Multicast instead of replicated counter, so players joining mid match don't clear flags of those who already finished it
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastMatchReset();
 };
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDGhostRacer.h"
+#include "MovementDemo/MDCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "Materials/MaterialInterface.h"
+
+AMDGhostRacer::AMDGhostRacer()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>("RootComp"));
+
+	MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>("MeshComp");
+	MeshComp->SetupAttachment(GetRootComponent());
+	MeshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	MeshComp->SetGenerateOverlapEvents(false);
+	MeshComp->SetCastShadow(false);
+	MeshComp->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	MeshComp->bComponentUseFixedSkelBounds = true;
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void AMDGhostRacer::InitFromCharacter(const AMDCharacter& Character, UMaterialInterface* Material)
+{
+	const USkeletalMeshComponent* CharacterMesh = Character.GetMesh();
+	MeshComp->SetRelativeTransform(CharacterMesh->GetRelativeTransform());
+	MeshComp->SetSkinnedAssetAndUpdate(CharacterMesh->GetSkinnedAsset());
+	MeshComp->SetAnimInstanceClass(CharacterMesh->GetAnimClass());
+	if(Material)
+	{
+		for(int32 Slot = 0; Slot < MeshComp->GetNumMaterials(); ++Slot)
+		{
+			MeshComp->SetMaterial(Slot, Material);
+		}
+	}
+
+	// Snapshot must be written before the anim update reads it
+	MeshComp->AddTickPrerequisiteActor(this);
+}
+
+void AMDGhostRacer::StartPlayback(const FMDGhostRecording& Recording, double InStartingShotServerTime)
+{
+	Recording.Decode(Frames);
+	SampleRate = Recording.SampleRate;
+	Duration = Recording.Duration;
+	StartingShotServerTime = InStartingShotServerTime;
+
+	if(Frames.IsEmpty())
+	{
+		StopPlayback();
+		return;
+	}
+
+	ApplyRaceTime(0.0);
+	SetActorHiddenInGame(false);
+	SetActorTickEnabled(true);
+}
+
+void AMDGhostRacer::StopPlayback()
+{
+	SetActorHiddenInGame(true);
+	SetActorTickEnabled(false);
+}
+
+void AMDGhostRacer::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	const auto* GS = GetWorld()->GetGameState();
+	if(!GS)
+	{
+		return;
+	}
+
+	// Stays at the start during countdown
+	const double RaceTime = FMath::Max(0.0, GS->GetServerWorldTimeSeconds() - StartingShotServerTime);
+	if(RaceTime > Duration + LingerTime)
+	{
+		StopPlayback();
+		return;
+	}
+
+	ApplyRaceTime(RaceTime);
+}
+
+void AMDGhostRacer::ApplyRaceTime(double RaceTime)
+{
+	const double FrameTime = RaceTime * SampleRate;
+	const int32 LastFrame = Frames.Num() - 1;
+	const int32 Idx = FMath::Clamp(FMath::FloorToInt32(FrameTime), 0, LastFrame);
+	const int32 NextIdx = FMath::Min(Idx + 1, LastFrame);
+	const double Alpha = FMath::Clamp(FrameTime - Idx, 0.0, 1.0);
+	const FMDGhostFrame& Frame = Frames[Idx];
+	const FMDGhostFrame& NextFrame = Frames[NextIdx];
+
+	const FVector Location = FMath::Lerp(Frame.Location, NextFrame.Location, Alpha);
+	const FRotator Rotation = FMath::Lerp(Frame.PawnRotation, NextFrame.PawnRotation, Alpha);
+	SetActorLocationAndRotation(Location, Rotation);
+
+	// Movement state is not interpolated, velocity comes from the samples around us
+	AnimSnapshot.Velocity = Idx == NextIdx ? FVector::ZeroVector : (NextFrame.Location - Frame.Location) * SampleRate;
+	AnimSnapshot.PawnRotation = Rotation;
+	AnimSnapshot.AimRotation = FMath::Lerp(Frame.AimRotation, NextFrame.AimRotation, Alpha);
+	AnimSnapshot.WallRunSide = Frame.WallRunSide;
+	AnimSnapshot.bIsFalling = Frame.bIsFalling;
+	AnimSnapshot.bIsWallRunning = Frame.bIsWallRunning;
+	AnimSnapshot.bIsCrouching = Frame.bIsCrouching;
+	AnimSnapshot.bIsSliding = Frame.bIsSliding;
+	AnimSnapshot.bIsMantling = Frame.bIsMantling;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
+#include "MovementDemo/MDGhostRecording.h"
+#include "MDGhostRacer.generated.h"
+
+class AMDCharacter;
+class UMaterialInterface;
+class USkeletalMeshComponent;
+
+/**
+ * Ghost of the local player's best run. Spawned locally by MDGhostSubsystem, never replicated.
+ * It's only a skeletal mesh: no movement component, no collision and no shadow. Each tick it samples the recording at current race time
+ * and fills an FMDAnimSnapshot, which UMDPlayerAnimInstance reads instead of a movement component's one. Anim graph runs with reduced work.
+ */
+UCLASS(Transient, NotPlaceable)
+class MOVEMENTDEMO_API AMDGhostRacer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	AMDGhostRacer();
+
+	// Copies mesh, anim class and mesh offset from the character. Material overrides all slots if set.
+	void InitFromCharacter(const AMDCharacter& Character, UMaterialInterface* Material);
+
+	// Plays the recording from the starting shot. Recording is decoded once here.
+	void StartPlayback(const FMDGhostRecording& Recording, double InStartingShotServerTime);
+
+	void StopPlayback();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	const FMDAnimSnapshot& GetAnimSnapshot() const { return AnimSnapshot; }
+
+protected:
+
+	UPROPERTY(VisibleAnywhere)
+	USkeletalMeshComponent* MeshComp;
+
+	// How long ghost stays at the goal after its run has ended
+	UPROPERTY(EditDefaultsOnly, meta = (ForceUnits = "s"))
+	float LingerTime = 2.0f;
+
+	TArray<FMDGhostFrame> Frames;
+
+	float SampleRate = 20.0f;
+
+	double Duration = 0.0;
+
+	double StartingShotServerTime = 0.0;
+
+	FMDAnimSnapshot AnimSnapshot;
+
+	void ApplyRaceTime(double RaceTime);
+};
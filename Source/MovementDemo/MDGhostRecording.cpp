@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDGhostRecording.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
+
+namespace MDGhostRecording
+{
+	enum EFlags : uint8
+	{
+		Falling = 1 << 0,
+		WallRunning = 1 << 1,
+		Crouching = 1 << 2,
+		Sliding = 1 << 3,
+		Mantling = 1 << 4,
+		WallRunSideShift = 5, // 2 bits
+	};
+
+	static void WriteVarInt(TArray<uint8>& Data, int32 Value)
+	{
+		// Zigzag, so small negative values are small too
+		uint32 Encoded = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+		while(Encoded >= 0x80)
+		{
+			Data.Add(static_cast<uint8>(Encoded | 0x80));
+			Encoded >>= 7;
+		}
+		Data.Add(static_cast<uint8>(Encoded));
+	}
+
+	static int32 ReadVarInt(const TArray<uint8>& Data, int32& Offset)
+	{
+		uint32 Encoded = 0;
+		for(int32 Shift = 0; Shift < 35 && Data.IsValidIndex(Offset); Shift += 7)
+		{
+			const uint8 Byte = Data[Offset++];
+			Encoded |= static_cast<uint32>(Byte & 0x7F) << Shift;
+			if((Byte & 0x80) == 0)
+			{
+				break;
+			}
+		}
+		return static_cast<int32>(Encoded >> 1) ^ -static_cast<int32>(Encoded & 1);
+	}
+
+	static uint8 ReadByte(const TArray<uint8>& Data, int32& Offset)
+	{
+		return Data.IsValidIndex(Offset) ? Data[Offset++] : 0;
+	}
+}
+
+FMDGhostFrame FMDGhostFrame::FromAnimSnapshot(const FVector& Location, const FMDAnimSnapshot& Snapshot)
+{
+	FMDGhostFrame Frame;
+	Frame.Location = Location;
+	Frame.PawnRotation = Snapshot.PawnRotation;
+	Frame.AimRotation = Snapshot.AimRotation;
+	Frame.WallRunSide = Snapshot.WallRunSide;
+	Frame.bIsFalling = Snapshot.bIsFalling;
+	Frame.bIsWallRunning = Snapshot.bIsWallRunning;
+	Frame.bIsCrouching = Snapshot.bIsCrouching;
+	Frame.bIsSliding = Snapshot.bIsSliding;
+	Frame.bIsMantling = Snapshot.bIsMantling;
+	return Frame;
+}
+
+void FMDGhostRecording::Reset(float NewSampleRate)
+{
+	SampleRate = NewSampleRate;
+	Duration = 0.0;
+	NumFrames = 0;
+	Data.Reset();
+	LastLocation = FIntVector::ZeroValue;
+	LastYaw = 0;
+}
+
+void FMDGhostRecording::AddFrame(const FMDGhostFrame& Frame)
+{
+	using namespace MDGhostRecording;
+
+	const FIntVector Location(FMath::RoundToInt32(Frame.Location.X), FMath::RoundToInt32(Frame.Location.Y), FMath::RoundToInt32(Frame.Location.Z));
+	WriteVarInt(Data, Location.X - LastLocation.X);
+	WriteVarInt(Data, Location.Y - LastLocation.Y);
+	WriteVarInt(Data, Location.Z - LastLocation.Z);
+	LastLocation = Location;
+
+	// Signed 16 bit delta wraps around correctly when yaw goes past 360
+	const int32 Yaw = FRotator::CompressAxisToShort(Frame.PawnRotation.Yaw);
+	WriteVarInt(Data, static_cast<int16>(static_cast<uint16>(Yaw - LastYaw)));
+	LastYaw = Yaw;
+
+	Data.Add(FRotator::CompressAxisToByte(Frame.AimRotation.Pitch));
+	Data.Add(FRotator::CompressAxisToByte(Frame.AimRotation.Yaw));
+
+	uint8 Flags = static_cast<uint8>(Frame.WallRunSide) << WallRunSideShift;
+	Flags |= Frame.bIsFalling ? Falling : 0;
+	Flags |= Frame.bIsWallRunning ? WallRunning : 0;
+	Flags |= Frame.bIsCrouching ? Crouching : 0;
+	Flags |= Frame.bIsSliding ? Sliding : 0;
+	Flags |= Frame.bIsMantling ? Mantling : 0;
+	Data.Add(Flags);
+
+	++NumFrames;
+}
+
+void FMDGhostRecording::Decode(TArray<FMDGhostFrame>& OutFrames) const
+{
+	using namespace MDGhostRecording;
+
+	OutFrames.Reset(NumFrames);
+
+	FIntVector Location = FIntVector::ZeroValue;
+	int32 Yaw = 0;
+	int32 Offset = 0;
+	for(int32 Idx = 0; Idx < NumFrames && Offset < Data.Num(); ++Idx)
+	{
+		Location.X += ReadVarInt(Data, Offset);
+		Location.Y += ReadVarInt(Data, Offset);
+		Location.Z += ReadVarInt(Data, Offset);
+		Yaw = static_cast<uint16>(Yaw + ReadVarInt(Data, Offset));
+
+		FMDGhostFrame& Frame = OutFrames.AddDefaulted_GetRef();
+		Frame.Location = FVector(Location);
+		Frame.PawnRotation = FRotator(0.0, FRotator::DecompressAxisFromShort(static_cast<uint16>(Yaw)), 0.0);
+		const uint8 AimPitch = ReadByte(Data, Offset);
+		const uint8 AimYaw = ReadByte(Data, Offset);
+		Frame.AimRotation = FRotator(FRotator::DecompressAxisFromByte(AimPitch), FRotator::DecompressAxisFromByte(AimYaw), 0.0);
+
+		const uint8 Flags = ReadByte(Data, Offset);
+		Frame.WallRunSide = static_cast<EMDWallRunSide>((Flags >> WallRunSideShift) & 0x3);
+		Frame.bIsFalling = (Flags & Falling) != 0;
+		Frame.bIsWallRunning = (Flags & WallRunning) != 0;
+		Frame.bIsCrouching = (Flags & Crouching) != 0;
+		Frame.bIsSliding = (Flags & Sliding) != 0;
+		Frame.bIsMantling = (Flags & Mantling) != 0;
+	}
+}
+
+bool FMDGhostRecording::Serialize(FArchive& Ar)
+{
+	uint32 Magic = FileMagic;
+	uint32 Version = FileVersion;
+	Ar << Magic;
+	Ar << Version;
+	if(Ar.IsLoading() && (Magic != FileMagic || Version != FileVersion))
+	{
+		return false;
+	}
+
+	Ar << SampleRate;
+	Ar << Duration;
+	Ar << NumFrames;
+	Ar << Data;
+	return !Ar.IsError() && SampleRate > 0.0f && NumFrames >= 0;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MovementDemo/MDProxyState.h"
+
+struct FMDAnimSnapshot;
+
+// One decoded sample of a ghost recording
+struct FMDGhostFrame
+{
+	FVector Location = FVector::ZeroVector;
+
+	FRotator PawnRotation = FRotator::ZeroRotator;
+
+	FRotator AimRotation = FRotator::ZeroRotator;
+
+	EMDWallRunSide WallRunSide = EMDWallRunSide::None;
+
+	bool bIsFalling = false;
+
+	bool bIsWallRunning = false;
+
+	bool bIsCrouching = false;
+
+	bool bIsSliding = false;
+
+	bool bIsMantling = false;
+
+	static FMDGhostFrame FromAnimSnapshot(const FVector& Location, const FMDAnimSnapshot& Snapshot);
+};
+
+/**
+ * Compressed run of the local player, sampled at fixed SampleRate. Frames are stored as a byte stream:
+ * 1. Location is quantized to centimeters and stored as delta to the previous frame, zigzag varint per axis. Running moves a few cm per sample, so 1-2 bytes per axis.
+ * 2. Pawn yaw is quantized to 16 bits and stored as delta the same way. Aim pitch and yaw are 8 bits each.
+ * 3. Movement state (falling, wall running, crouching, sliding, mantling, wall run side) is one byte.
+ * A minute long run at 20Hz is around 10KB.
+ */
+struct FMDGhostRecording
+{
+	static constexpr uint32 FileMagic = 0x4D444748; // MDGH
+
+	static constexpr uint32 FileVersion = 1;
+
+	float SampleRate = 20.0f;
+
+	// Race time of the run, set when the run is completed
+	double Duration = 0.0;
+
+	int32 NumFrames = 0;
+
+	TArray<uint8> Data;
+
+	bool IsEmpty() const { return NumFrames == 0; }
+
+	void Reset(float NewSampleRate);
+
+	void AddFrame(const FMDGhostFrame& Frame);
+
+	void Decode(TArray<FMDGhostFrame>& OutFrames) const;
+
+	// Returns false if the archive doesn't contain a valid recording
+	bool Serialize(FArchive& Ar);
+
+private:
+
+	// Quantized values of the last added frame, deltas are against these
+	FIntVector LastLocation = FIntVector::ZeroValue;
+
+	int32 LastYaw = 0;
+};
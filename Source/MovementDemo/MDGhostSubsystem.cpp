@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDGhostSubsystem.h"
+#include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDCharacterMovementComponent.h"
+#include "MovementDemo/MDGameStateBase.h"
+#include "MovementDemo/MDGhostRacer.h"
+#include "MovementDemo/MDPlayerState.h"
+#include "Materials/MaterialInterface.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Logging/StructuredLog.h"
+
+bool UMDGhostSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	const UWorld* World = CastChecked<UWorld>(Outer);
+	return World->GetNetMode() != NM_DedicatedServer; // no local player on dedicated servers
+}
+
+void UMDGhostSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if(bEnableGhost)
+	{
+		LoadBestRun();
+	}
+}
+
+void UMDGhostSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(!bEnableGhost)
+	{
+		return;
+	}
+
+	const auto* GS = GetWorld()->GetGameState<AMDGameStateBase>();
+	const auto* Racer = GetLocalRacer();
+	const auto* PS = Racer ? Racer->GetPlayerState<AMDPlayerState>() : nullptr;
+	if(!GS || !PS)
+	{
+		return;
+	}
+
+	const double StartingShotTime = GS->GetStartingShotServerTime();
+	if(StartingShotTime <= 0.0)
+	{
+		return;
+	}
+
+	// New match
+	if(StartingShotTime != RecordingStartingShotTime)
+	{
+		RecordingStartingShotTime = StartingShotTime;
+		CurrentRun.Reset(RecordSampleRate);
+		bRecording = true;
+
+		if(!BestRun.IsEmpty())
+		{
+			StartGhost(*Racer, StartingShotTime);
+		}
+	}
+
+	if(PS->HasReachedGoal())
+	{
+		bRecording = false;
+	}
+
+	const double RaceTime = GS->GetServerWorldTimeSeconds() - StartingShotTime;
+	if(!bRecording || RaceTime < 0.0)
+	{
+		return;
+	}
+
+	// Fixed rate regardless of frame rate. Samples missed in a hitch get the current pose.
+	const int32 WantedFrames = FMath::FloorToInt32(RaceTime * CurrentRun.SampleRate) + 1;
+	if(CurrentRun.NumFrames < WantedFrames)
+	{
+		const auto* MoveComp = CastChecked<UMDCharacterMovementComponent>(Racer->GetCharacterMovement());
+		const FMDGhostFrame Frame = FMDGhostFrame::FromAnimSnapshot(Racer->GetActorLocation(), MoveComp->GetAnimSnapshot());
+		while(CurrentRun.NumFrames < WantedFrames)
+		{
+			CurrentRun.AddFrame(Frame);
+		}
+	}
+}
+
+TStatId UMDGhostSubsystem::GetStatId() const
+{
+	return UObject::GetStatID();
+}
+
+void UMDGhostSubsystem::OnLocalBestTimeChanged(double BestTime)
+{
+	const auto* Racer = GetLocalRacer();
+	const auto* PS = Racer ? Racer->GetPlayerState<AMDPlayerState>() : nullptr;
+
+	// Best time also changes when it's restored or reset, only a run that just reached the goal counts
+	if(!bEnableGhost || !bRecording || CurrentRun.IsEmpty() || BestTime <= 0.0 || !PS || !PS->HasReachedGoal())
+	{
+		return;
+	}
+
+	bRecording = false;
+	CurrentRun.Duration = BestTime;
+	BestRun = MoveTemp(CurrentRun);
+	CurrentRun.Reset(RecordSampleRate);
+	SaveBestRun();
+}
+
+AMDCharacter* UMDGhostSubsystem::GetLocalRacer() const
+{
+	const auto* PC = GetWorld()->GetFirstPlayerController();
+	return PC ? PC->GetPawn<AMDCharacter>() : nullptr;
+}
+
+void UMDGhostSubsystem::StartGhost(const AMDCharacter& Racer, double StartingShotTime)
+{
+	if(!IsValid(Ghost))
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Ghost = GetWorld()->SpawnActor<AMDGhostRacer>(SpawnParams);
+		Ghost->InitFromCharacter(Racer, GhostMaterial.LoadSynchronous());
+	}
+
+	Ghost->StartPlayback(BestRun, StartingShotTime);
+}
+
+FString UMDGhostSubsystem::GetBestRunPath() const
+{
+	const FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	return FPaths::ProjectSavedDir() / TEXT("Ghosts") / MapName + TEXT(".mdghost");
+}
+
+void UMDGhostSubsystem::SaveBestRun()
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	BestRun.Serialize(Writer);
+
+	// Few kilobytes, written once per new best time
+	const FString Path = GetBestRunPath();
+	if(FFileHelper::SaveArrayToFile(Bytes, *Path))
+	{
+		UE_LOGFMT(LogTemp, Log, "Ghost: saved {Time}s run, {Frames} frames in {Bytes} bytes to {Path}.", BestRun.Duration, BestRun.NumFrames, Bytes.Num(), Path);
+	}
+	else
+	{
+		UE_LOGFMT(LogTemp, Warning, "Ghost: failed to save best run to {Path}.", Path);
+	}
+}
+
+void UMDGhostSubsystem::LoadBestRun()
+{
+	const FString Path = GetBestRunPath();
+	TArray<uint8> Bytes;
+	if(!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	FMemoryReader Reader(Bytes);
+	if(!BestRun.Serialize(Reader))
+	{
+		UE_LOGFMT(LogTemp, Warning, "Ghost: {Path} is not a valid recording, ignoring it.", Path);
+		BestRun.Reset(RecordSampleRate);
+	}
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MovementDemo/MDGhostRecording.h"
+#include "MDGhostSubsystem.generated.h"
+
+class AMDCharacter;
+class AMDGhostRacer;
+class UMaterialInterface;
+
+/**
+ * Client side WorldSubsystem that lets local player race against their best run. Not created on dedicated servers.
+ * 1. Every run of the local pawn is recorded from the starting shot until goal, at fixed RecordSampleRate. See FMDGhostRecording for the format.
+ *    Recording only reads the movement component's anim snapshot and appends a few bytes per sample, so it's always on.
+ * 2. When local player's best time changes after reaching the goal, the recorded run becomes the best run and is saved to Saved/Ghosts/<Map>.mdghost.
+ * 3. On each starting shot, best run is played back by AMDGhostRacer, which is only a mesh.
+ */
+UCLASS(Config = Game)
+class MOVEMENTDEMO_API UMDGhostSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Called when local player's best time changes. If it was set by the run we just recorded, that run becomes the ghost.
+	void OnLocalBestTimeChanged(double BestTime);
+
+protected:
+
+	UPROPERTY(Config)
+	bool bEnableGhost = true;
+
+	UPROPERTY(Config, meta = (ClampMin = "1", UIMin = "1", ForceUnits = "Hz"))
+	float RecordSampleRate = 20.0f;
+
+	// Overrides all material slots of the ghost mesh, uses character's materials if not set
+	UPROPERTY(Config)
+	TSoftObjectPtr<UMaterialInterface> GhostMaterial;
+
+	UPROPERTY(Transient)
+	AMDGhostRacer* Ghost;
+
+	FMDGhostRecording CurrentRun;
+
+	FMDGhostRecording BestRun;
+
+	// Starting shot of CurrentRun. New starting shot means new match.
+	double RecordingStartingShotTime = 0.0;
+
+	bool bRecording = false;
+
+	AMDCharacter* GetLocalRacer() const;
+
+	void StartGhost(const AMDCharacter& Racer, double StartingShotTime);
+
+	FString GetBestRunPath() const;
+
+	void SaveBestRun();
+
+	void LoadBestRun();
+};
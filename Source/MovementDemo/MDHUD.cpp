@@ -5,6 +5,13 @@
 #include "MovementDemo/MDPlayerMainHUDWidget.h"
 #include "MovementDemo/MDGameStateBase.h"
 #include "MovementDemo/MDPlayerState.h"
+#include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDSignificanceSubsystem.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "Engine/Font.h"
+#include "CanvasItem.h"
 #include "Logging/StructuredLog.h"
 
 AMDHUD::AMDHUD()
@@ -16,8 +23,8 @@ AMDHUD::AMDHUD()
 
 void AMDHUD::CreateWidgetsForLocalPlayer()
 {
-	// Already created
-	if(MainWidget != nullptr)
+	// Already created. Dedicated server has no viewport, in server target this compiles out.
+	if(MainWidget != nullptr || IsRunningDedicatedServer())
 	{
 		return;
 	}
@@ -40,19 +47,6 @@ void AMDHUD::CreateWidgetsForLocalPlayer()
 	}
 }
 
-AMDHUD* AMDHUD::GetLocalHUD(const UWorld* World)
-{
-	for (auto It = World->GetPlayerControllerIterator(); It; ++It)
-	{
-		auto* PC = It->Get();
-		if (PC->IsLocalController())
-		{
-			return PC->GetHUD<AMDHUD>();
-		}
-	}
-	return nullptr;
-}
-
 void AMDHUD::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
@@ -74,48 +68,118 @@ void AMDHUD::Tick(float DeltaSeconds)
 	}
 }
 
-void AMDHUD::SetNameForPlayer(AMDPlayerState* PlayerState)
+void AMDHUD::DrawHUD()
 {
-	if (!IsValid(MainWidget) || !IsValid(PlayerState))
+	Super::DrawHUD();
+
+	DrawNamePlates();
+}
+
+void AMDHUD::InvalidateNamePlate(const AMDPlayerState* PlayerState)
+{
+	NamePlates.Remove(PlayerState);
+}
+
+void AMDHUD::DrawNamePlates()
+{
+	const auto* PC = GetOwningPlayerController();
+	const auto* GS = GetWorld()->GetGameState();
+	if(!PC || !PC->PlayerCameraManager || !GS)
 	{
 		return;
 	}
 
-	if (IsLocalPlayerState(PlayerState))
+	UFont* Font = NamePlateFont ? NamePlateFont : GEngine->GetMediumFont();
+	const FVector CameraLocation = PC->PlayerCameraManager->GetCameraLocation();
+	const FVector CameraForward = PC->PlayerCameraManager->GetCameraRotation().Vector();
+	const double MaxDistanceSquared = FMath::Square(NamePlateMaxDistance);
+	const auto* SignificanceSubsystem = GetWorld()->GetSubsystem<UMDSignificanceSubsystem>();
+
+	// PlayerArray instead of actor iterator, which would allocate every frame
+	for(const APlayerState* PlayerState : GS->PlayerArray)
 	{
-		MainWidget->SetLocalPlayerName(PlayerState->GetPlayerName());
+		const auto* PS = Cast<AMDPlayerState>(PlayerState);
+		const auto* Racer = PS ? PS->GetPawn<AMDCharacter>() : nullptr;
+		if(!Racer || Racer->IsLocallyControlled())
+		{
+			continue;
+		}
+
+		const FVector Location = Racer->GetActorLocation() + FVector::UpVector * NamePlateHeight;
+		const FVector ToRacer = Location - CameraLocation;
+		if(ToRacer.SizeSquared() > MaxDistanceSquared || (ToRacer | CameraForward) <= 0.0)
+		{
+			continue;
+		}
+
+		// Renderer already culled occluded meshes, so this doubles as occlusion check without traces
+		if(!Racer->WasRecentlyRendered(0.1f))
+		{
+			continue;
+		}
+
+		if(SignificanceSubsystem && !SignificanceSubsystem->GetSettings(Racer->GetSignificanceLevel()).bShowNamePlate)
+		{
+			continue;
+		}
+
+		const FMDNamePlate& NamePlate = FindOrAddNamePlate(*PS, Font);
+		const FVector ScreenLocation = Project(Location);
+
+		// Canvas batches all text with the same font into one draw
+		FCanvasTextItem TextItem(FVector2D(ScreenLocation.X - NamePlate.Size.X * 0.5, ScreenLocation.Y - NamePlate.Size.Y), NamePlate.Text, Font, NamePlateColor);
+		TextItem.EnableShadow(FLinearColor::Black);
+		Canvas->DrawItem(TextItem);
 	}
-	else
+}
+
+const FMDNamePlate& AMDHUD::FindOrAddNamePlate(const AMDPlayerState& PlayerState, UFont* Font)
+{
+	if(const FMDNamePlate* NamePlate = NamePlates.Find(&PlayerState))
 	{
-		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
+		return *NamePlate;
 	}
+
+	FMDNamePlate& NamePlate = NamePlates.Add(&PlayerState);
+	const FString PlayerName = PlayerState.GetPlayerName();
+	NamePlate.Text = FText::FromString(PlayerName);
+	float Width = 0.0f;
+	float Height = 0.0f;
+	Canvas->TextSize(Font, PlayerName, Width, Height);
+	NamePlate.Size = FVector2D(Width, Height);
+	return NamePlate;
 }
 
-void AMDHUD::SetBestTimeForPlayer(AMDPlayerState* PlayerState)
+void AMDHUD::RefreshPlayer(AMDPlayerState* PlayerState, EMDPlayerUIChange Changes)
 {
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::Name))
+	{
+		InvalidateNamePlate(PlayerState);
+	}
+
 	if (!IsValid(MainWidget) || !IsValid(PlayerState))
 	{
 		return;
 	}
 
-	if(IsLocalPlayerState(PlayerState))
+	// Remote widget shows everything at once, one refresh covers all changes
+	if (!IsLocalPlayerState(PlayerState))
 	{
-		MainWidget->SetLocalBestTime(PlayerState->GetBestCompletedTime());
+		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
+		return;
 	}
-	else
+
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::Name))
 	{
-		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
+		MainWidget->SetLocalPlayerName(PlayerState->GetPlayerName());
 	}
-}
 
-void AMDHUD::SetLastTimeForPlayer(AMDPlayerState* PlayerState)
-{
-	if (!IsValid(MainWidget) || !IsValid(PlayerState))
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::BestTime))
 	{
-		return;
+		MainWidget->SetLocalBestTime(PlayerState->GetBestCompletedTime());
 	}
 
-	if (IsLocalPlayerState(PlayerState))
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::LastTime))
 	{
 		auto LastCompletedTime = PlayerState->GetLastCompletedTime();
 		MainWidget->SetLocalLastTime(LastCompletedTime);
@@ -123,46 +187,16 @@ void AMDHUD::SetLastTimeForPlayer(AMDPlayerState* PlayerState)
 		SetActorTickEnabled(false);
 		MainWidget->SetCurrentMatchTimeText(LastCompletedTime);
 	}
-	else
-	{
-		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
-	}
-}
 
-void AMDHUD::SetWinsForPlayer(AMDPlayerState* PlayerState)
-{
-	if (!IsValid(MainWidget) || !IsValid(PlayerState))
-	{
-		return;
-	}
-
-	if (IsLocalPlayerState(PlayerState))
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::Wins))
 	{
 		MainWidget->SetLocalWins(PlayerState->GetWinCount());
 	}
-	else
-	{
-		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
-	}
-}
-
-void AMDHUD::SetPlayerReachedGoal(AMDPlayerState* PlayerState)
-{
-	if (!IsValid(MainWidget) || !IsValid(PlayerState))
-	{
-		return;
-	}
 
-	if(IsLocalPlayerState(PlayerState))
-	{
-		if(!PlayerState->HasReachedGoal())
-		{
-			SetActorTickEnabled(true);
-		}
-	}
-	else // We don't currently use this info on remote players, but we might just update the UI just in case, if we do use it in the future
+	// After last time, so a reset in the same frame starts the clock again
+	if (EnumHasAnyFlags(Changes, EMDPlayerUIChange::ReachedGoal) && !PlayerState->HasReachedGoal())
 	{
-		CreateOrRefreshWidgetForRemotePlayer(PlayerState);
+		SetActorTickEnabled(true);
 	}
 }
 
@@ -183,6 +217,8 @@ void AMDHUD::CreateOrRefreshWidgetForRemotePlayer(AMDPlayerState* PlayerState)
 
 void AMDHUD::RemoveWidgetForRemotePlayer(AMDPlayerState* PlayerState)
 {
+	InvalidateNamePlate(PlayerState);
+
 	if (!IsValid(MainWidget))
 	{
 		return;
@@ -218,6 +254,14 @@ void AMDHUD::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if(GetOwningPlayerController()->IsLocalController())
+	{
+		if(auto* Router = GetWorld()->GetSubsystem<UMDUIEventRouter>())
+		{
+			Router->RegisterLocalHUD(this);
+		}
+	}
+
 	// Create Listen Server player widget here, we don't need to wait for replication
 	// Clients will create theirs in AMDPlayerController::OnRep_PlayerState
 	if(GetNetMode() < NM_Client && GetNetMode() != NM_DedicatedServer && GetOwningPlayerController()->IsLocalController())
@@ -226,6 +270,16 @@ void AMDHUD::BeginPlay()
 	}
 }
 
+void AMDHUD::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(auto* Router = GetWorld()->GetSubsystem<UMDUIEventRouter>())
+	{
+		Router->UnregisterLocalHUD(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 bool AMDHUD::IsLocalPlayerState(AMDPlayerState* PlayerState) const
 {
 	check(GetOwningPlayerController()->GetPlayerState<AMDPlayerState>() != nullptr);
@@ -4,15 +4,27 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/HUD.h"
+#include "UObject/ObjectKey.h"
+#include "MovementDemo/MDUIEventRouter.h"
 #include "MDHUD.generated.h"
 
 class UMDPlayerMainHUDWidget;
 class AMDPlayerState;
+class UFont;
+
+// Name plate text is created and measured once per player, not every frame
+struct FMDNamePlate
+{
+	FText Text;
+
+	FVector2D Size = FVector2D::ZeroVector;
+};
 
 /**
  * MDHUD encapsulates all HUD/Widget/UI functionality.
  * The goal is that we don't need to ever do stuff like GetMainWidget() .. MainWidget->DoStuff, but instead we route all HUD/Widget/UI related stuff trough this class.
  * Because we can't guarantee that stuff replicate in order we want, we must be sure that stuff is valid before we try to update it. That's why we need lot of extra checks for valid etc.
+ * Names on top of remote players are drawn here in one canvas pass (DrawNamePlates), instead of a widget component per character.
  * TODO: write this again
  */
 UCLASS()
@@ -27,20 +39,15 @@ public:
 	// Called from AMDPlayerController::OnRep_PlayerState to ensure we have PlayerState
 	void CreateWidgetsForLocalPlayer();
 
-	// Helper to get local HUD
-	static AMDHUD* GetLocalHUD(const UWorld* World);
-
 	virtual void Tick(float DeltaSeconds) override;
 
-	void SetNameForPlayer(AMDPlayerState* PlayerState);
-
-	void SetBestTimeForPlayer(AMDPlayerState* PlayerState);
+	virtual void DrawHUD() override;
 
-	void SetLastTimeForPlayer(AMDPlayerState* PlayerState);
+	// Call when player's name changes, so the name plate is measured again
+	void InvalidateNamePlate(const AMDPlayerState* PlayerState);
 
-	void SetWinsForPlayer(AMDPlayerState* PlayerState);
-
-	void SetPlayerReachedGoal(AMDPlayerState* PlayerState);
+	// Called by UMDUIEventRouter at most once per frame per player, with everything that changed since last time
+	void RefreshPlayer(AMDPlayerState* PlayerState, EMDPlayerUIChange Changes);
 
 	void CreateOrRefreshWidgetForRemotePlayer(AMDPlayerState* PlayerState);
 
@@ -56,8 +63,31 @@ protected:
 	UPROPERTY(Transient)
 	UMDPlayerMainHUDWidget* MainWidget;
 
+	// Engine medium font if not set
+	UPROPERTY(EditDefaultsOnly, Category = "Name Plates")
+	UFont* NamePlateFont;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Name Plates")
+	FLinearColor NamePlateColor = FLinearColor::White;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Name Plates", meta = (ClampMin = "0", UIMin = "0", ForceUnits = "cm"))
+	float NamePlateMaxDistance = 4000.0f;
+
+	// Above actor location
+	UPROPERTY(EditDefaultsOnly, Category = "Name Plates", meta = (ForceUnits = "cm"))
+	float NamePlateHeight = 110.0f;
+
+	TMap<TObjectKey<AMDPlayerState>, FMDNamePlate> NamePlates;
+
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Culls by distance, view direction, rendering and significance, then draws the rest
+	void DrawNamePlates();
+
+	const FMDNamePlate& FindOrAddNamePlate(const AMDPlayerState& PlayerState, UFont* Font);
+
 	// Helper to check if passed in PlayerState is ours. NOT safe to call if PlayerController's PlayerState isn't replicated yet!
 	bool IsLocalPlayerState(AMDPlayerState* PlayerState) const;
 };
@@ -0,0 +1,432 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDLeaderboardSubsystem.h"
+#include "MovementDemo/MDPlayerState.h"
+#include "MovementDemo/MDScoreboard.h"
+#include "Algo/BinarySearch.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Logging/StructuredLog.h"
+
+namespace MDLeaderboard
+{
+	static constexpr uint32 FileMagic = 0x4D444C42; // MDLB
+
+	static constexpr uint32 FileVersion = 1;
+
+	enum class ERecordType : uint8
+	{
+		BestTime,
+		Wins,
+	};
+
+	static void WriteHeader(FArchive& Ar)
+	{
+		uint32 Magic = FileMagic;
+		uint32 Version = FileVersion;
+		Ar << Magic;
+		Ar << Version;
+	}
+
+	static void WriteBestTimeRecord(FArchive& Ar, FString PlayerKey, FString PlayerName, int32 TimeMs)
+	{
+		uint8 Type = static_cast<uint8>(ERecordType::BestTime);
+		Ar << Type;
+		Ar << PlayerKey;
+		Ar << PlayerName;
+		Ar << TimeMs;
+	}
+
+	static void WriteWinsRecord(FArchive& Ar, FString PlayerKey, int32 Delta)
+	{
+		uint8 Type = static_cast<uint8>(ERecordType::Wins);
+		Ar << Type;
+		Ar << PlayerKey;
+		Ar << Delta;
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs DumpCmd(
+		TEXT("MD.Leaderboard"),
+		TEXT("Prints the fastest players of the current course. Server only. Usage: MD.Leaderboard [Count=10]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (auto* Subsystem = World ? World->GetSubsystem<UMDLeaderboardSubsystem>() : nullptr)
+			{
+				Subsystem->DumpTop(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10);
+			}
+		}));
+}
+
+const FMDLeaderboardEntry* FMDLeaderboardIndex::Find(const FString& PlayerKey) const
+{
+	const int32* EntryIndex = EntryIndexByKey.Find(PlayerKey);
+	return EntryIndex ? &Entries[*EntryIndex] : nullptr;
+}
+
+bool FMDLeaderboardIndex::ApplyBestTime(const FString& PlayerKey, const FString& PlayerName, int32 TimeMs, bool bKeepSorted)
+{
+	const int32 EntryIndex = FindOrAddEntry(PlayerKey);
+	FMDLeaderboardEntry& Entry = Entries[EntryIndex];
+	if(TimeMs < 0 || (Entry.BestTimeMs >= 0 && Entry.BestTimeMs <= TimeMs))
+	{
+		return false;
+	}
+
+	if(bKeepSorted)
+	{
+		// Binary search both ways. Moving the elements in between is a memmove, which is fine for the rare new best time.
+		if(Entry.BestTimeMs >= 0)
+		{
+			const int32 OldPosition = Algo::LowerBound(Ranks, FRank{ Entry.BestTimeMs, EntryIndex });
+			check(Ranks.IsValidIndex(OldPosition) && Ranks[OldPosition].EntryIndex == EntryIndex);
+			Ranks.RemoveAt(OldPosition, 1, false);
+		}
+		const FRank NewRank{ TimeMs, EntryIndex };
+		Ranks.Insert(NewRank, Algo::LowerBound(Ranks, NewRank));
+	}
+
+	Entry.PlayerName = PlayerName;
+	Entry.BestTimeMs = TimeMs;
+	return true;
+}
+
+void FMDLeaderboardIndex::ApplyWins(const FString& PlayerKey, int32 Delta)
+{
+	FMDLeaderboardEntry& Entry = Entries[FindOrAddEntry(PlayerKey)];
+	Entry.TotalWins = FMath::Max(0, Entry.TotalWins + Delta);
+}
+
+void FMDLeaderboardIndex::SortRanks()
+{
+	Ranks.Reset(Entries.Num());
+	for(int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		if(Entries[EntryIndex].BestTimeMs >= 0)
+		{
+			Ranks.Add({ Entries[EntryIndex].BestTimeMs, EntryIndex });
+		}
+	}
+	Ranks.Sort();
+}
+
+int32 FMDLeaderboardIndex::GetRank(const FString& PlayerKey) const
+{
+	const int32* EntryIndex = EntryIndexByKey.Find(PlayerKey);
+	if(!EntryIndex || Entries[*EntryIndex].BestTimeMs < 0)
+	{
+		return INDEX_NONE;
+	}
+
+	return Algo::LowerBound(Ranks, FRank{ Entries[*EntryIndex].BestTimeMs, *EntryIndex });
+}
+
+void FMDLeaderboardIndex::GetTop(int32 Count, TArray<FMDLeaderboardEntry>& OutEntries) const
+{
+	const int32 Num = FMath::Clamp(Count, 0, Ranks.Num());
+	OutEntries.Reset(Num);
+	for(int32 Position = 0; Position < Num; ++Position)
+	{
+		OutEntries.Add(Entries[Ranks[Position].EntryIndex]);
+	}
+}
+
+TUniquePtr<FMDLeaderboardIndex> FMDLeaderboardIndex::Load(const FString& Path)
+{
+	using namespace MDLeaderboard;
+
+	auto Index = MakeUnique<FMDLeaderboardIndex>();
+
+	// One read for the whole file, parsing from memory is much faster than many small reads
+	TArray<uint8> Bytes;
+	if(!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+	{
+		Index->bNeedsRewrite = true;
+		return Index;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic;
+	Reader << Version;
+	if(Reader.IsError() || Magic != FileMagic || Version != FileVersion)
+	{
+		UE_LOGFMT(LogTemp, Warning, "Leaderboard: {Path} is not a leaderboard file, starting a new one.", Path);
+		Index->bNeedsRewrite = true;
+		return Index;
+	}
+
+	while(!Reader.AtEnd())
+	{
+		const int64 RecordOffset = Reader.Tell();
+		uint8 Type = 0;
+		FString PlayerKey;
+		Reader << Type;
+		Reader << PlayerKey;
+		if(Type == static_cast<uint8>(ERecordType::BestTime))
+		{
+			FString PlayerName;
+			int32 TimeMs = INDEX_NONE;
+			Reader << PlayerName;
+			Reader << TimeMs;
+			if(!Reader.IsError())
+			{
+				Index->ApplyBestTime(PlayerKey, PlayerName, TimeMs, false);
+			}
+		}
+		else if(Type == static_cast<uint8>(ERecordType::Wins))
+		{
+			int32 Delta = 0;
+			Reader << Delta;
+			if(!Reader.IsError())
+			{
+				Index->ApplyWins(PlayerKey, Delta);
+			}
+		}
+		else
+		{
+			Reader.SetError();
+		}
+
+		// Server was probably stopped in the middle of a write, everything before it is fine
+		if(Reader.IsError())
+		{
+			UE_LOGFMT(LogTemp, Warning, "Leaderboard: ignoring damaged record at offset {Offset} of {Path}.", RecordOffset, Path);
+			Index->bNeedsRewrite = true;
+			break;
+		}
+		++Index->NumRecords;
+	}
+
+	Index->SortRanks();
+	return Index;
+}
+
+bool FMDLeaderboardIndex::SaveCompacted(const FString& Path) const
+{
+	using namespace MDLeaderboard;
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	WriteHeader(Writer);
+	for(const auto& Entry : Entries)
+	{
+		if(Entry.BestTimeMs >= 0)
+		{
+			WriteBestTimeRecord(Writer, Entry.PlayerKey, Entry.PlayerName, Entry.BestTimeMs);
+		}
+		if(Entry.TotalWins > 0)
+		{
+			WriteWinsRecord(Writer, Entry.PlayerKey, Entry.TotalWins);
+		}
+	}
+
+	// Write next to the old file and swap, so a crash never leaves us without a leaderboard
+	const FString TempPath = Path + TEXT(".tmp");
+	return FFileHelper::SaveArrayToFile(Bytes, *TempPath) && IFileManager::Get().Move(*Path, *TempPath, true);
+}
+
+int32 FMDLeaderboardIndex::FindOrAddEntry(const FString& PlayerKey)
+{
+	if(const int32* EntryIndex = EntryIndexByKey.Find(PlayerKey))
+	{
+		return *EntryIndex;
+	}
+
+	const int32 EntryIndex = Entries.AddDefaulted();
+	Entries[EntryIndex].PlayerKey = PlayerKey;
+	EntryIndexByKey.Add(PlayerKey, EntryIndex);
+	return EntryIndex;
+}
+
+bool UMDLeaderboardSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	const UWorld* World = CastChecked<UWorld>(Outer);
+	return World->GetNetMode() < NM_Client; // will be created in standalone, dedicated servers, and listen servers
+}
+
+bool UMDLeaderboardSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	// We only need this subsystem on Game worlds (PIE included). Editor worlds must not touch the file.
+	return (WorldType == EWorldType::Game || WorldType == EWorldType::PIE);
+}
+
+void UMDLeaderboardSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if(!bEnableLeaderboard)
+	{
+		return;
+	}
+
+	const FString MapName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	FilePath = FPaths::ProjectSavedDir() / TEXT("Leaderboards") / MapName + TEXT(".mdlb");
+
+	LoadTask = WritePipe.Launch(TEXT("MDLeaderboardLoad"), [Path = FilePath, CompactRecordsPerEntry = CompactRecordsPerEntry]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		TUniquePtr<FMDLeaderboardIndex> LoadedIndex = FMDLeaderboardIndex::Load(Path);
+
+		// Missing or damaged file is written again here, later records are appended after it
+		const bool bNeedsRewrite = LoadedIndex->bNeedsRewrite || LoadedIndex->NumRecords > LoadedIndex->GetNumEntries() * CompactRecordsPerEntry;
+		if(bNeedsRewrite && !LoadedIndex->SaveCompacted(Path))
+		{
+			UE_LOGFMT(LogTemp, Warning, "Leaderboard: failed to write {Path}.", Path);
+		}
+
+		UE_LOGFMT(LogTemp, Log, "Leaderboard: loaded {Records} records of {Players} players from {Path} in {Ms} ms.",
+			LoadedIndex->NumRecords, LoadedIndex->GetNumEntries(), Path, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		return LoadedIndex;
+	});
+}
+
+void UMDLeaderboardSubsystem::Deinitialize()
+{
+	// Don't lose records that are still on their way to disk
+	WritePipe.WaitUntilEmpty();
+
+	Super::Deinitialize();
+}
+
+void UMDLeaderboardSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Players can't join before this, so they never wait for the file
+	GetIndex();
+}
+
+void UMDLeaderboardSubsystem::ReportBestTime(const AMDPlayerState& PlayerState, double Time)
+{
+	auto* LeaderboardIndex = GetIndex();
+	const FString PlayerKey = GetPlayerKey(PlayerState);
+	if(!LeaderboardIndex || PlayerKey.IsEmpty())
+	{
+		return;
+	}
+
+	const int32 TimeMs = FMDScoreboardEntry::QuantizeTime(Time);
+	if(LeaderboardIndex->ApplyBestTime(PlayerKey, PlayerState.GetPlayerName(), TimeMs, true))
+	{
+		TArray<uint8> RecordBytes;
+		FMemoryWriter Writer(RecordBytes);
+		MDLeaderboard::WriteBestTimeRecord(Writer, PlayerKey, PlayerState.GetPlayerName(), TimeMs);
+		AppendRecord(MoveTemp(RecordBytes));
+	}
+}
+
+void UMDLeaderboardSubsystem::ReportWins(const AMDPlayerState& PlayerState, int32 Delta)
+{
+	auto* LeaderboardIndex = GetIndex();
+	const FString PlayerKey = GetPlayerKey(PlayerState);
+	if(!LeaderboardIndex || PlayerKey.IsEmpty() || Delta == 0)
+	{
+		return;
+	}
+
+	LeaderboardIndex->ApplyWins(PlayerKey, Delta);
+
+	TArray<uint8> RecordBytes;
+	FMemoryWriter Writer(RecordBytes);
+	MDLeaderboard::WriteWinsRecord(Writer, PlayerKey, Delta);
+	AppendRecord(MoveTemp(RecordBytes));
+}
+
+void UMDLeaderboardSubsystem::RestorePlayer(AMDPlayerState& PlayerState)
+{
+	auto* LeaderboardIndex = GetIndex();
+	const FString PlayerKey = GetPlayerKey(PlayerState);
+	const auto* Entry = LeaderboardIndex && !PlayerKey.IsEmpty() ? LeaderboardIndex->Find(PlayerKey) : nullptr;
+	if(Entry && Entry->BestTimeMs >= 0)
+	{
+		PlayerState.RestoreBestCompletedTime(FMDScoreboardEntry::DequantizeTime(Entry->BestTimeMs));
+	}
+	if(Entry && Entry->TotalWins > 0)
+	{
+		PlayerState.SetWinCount(Entry->TotalWins);
+	}
+}
+
+bool UMDLeaderboardSubsystem::IsTrackingPlayer(const AMDPlayerState& PlayerState)
+{
+	return GetIndex() && !GetPlayerKey(PlayerState).IsEmpty();
+}
+
+int32 UMDLeaderboardSubsystem::GetRank(const AMDPlayerState& PlayerState)
+{
+	const auto* LeaderboardIndex = GetIndex();
+	const FString PlayerKey = GetPlayerKey(PlayerState);
+	return LeaderboardIndex && !PlayerKey.IsEmpty() ? LeaderboardIndex->GetRank(PlayerKey) : INDEX_NONE;
+}
+
+void UMDLeaderboardSubsystem::GetTopEntries(int32 Count, TArray<FMDLeaderboardEntry>& OutEntries)
+{
+	OutEntries.Reset();
+	if(const auto* LeaderboardIndex = GetIndex())
+	{
+		LeaderboardIndex->GetTop(Count, OutEntries);
+	}
+}
+
+void UMDLeaderboardSubsystem::DumpTop(int32 Count)
+{
+	const auto* LeaderboardIndex = GetIndex();
+	if(!LeaderboardIndex)
+	{
+		UE_LOGFMT(LogTemp, Display, "Leaderboard is disabled.");
+		return;
+	}
+
+	TArray<FMDLeaderboardEntry> TopEntries;
+	LeaderboardIndex->GetTop(Count, TopEntries);
+	UE_LOGFMT(LogTemp, Display, "Leaderboard {Path}: {Ranked} ranked of {Players} players.", FilePath, LeaderboardIndex->GetNumRanked(), LeaderboardIndex->GetNumEntries());
+	for(int32 Position = 0; Position < TopEntries.Num(); ++Position)
+	{
+		const auto& Entry = TopEntries[Position];
+		UE_LOGFMT(LogTemp, Display, "  {Rank}. {Name} {Time}s, {Wins} wins", Position + 1, Entry.PlayerName, FMDScoreboardEntry::DequantizeTime(Entry.BestTimeMs), Entry.TotalWins);
+	}
+}
+
+FMDLeaderboardIndex* UMDLeaderboardSubsystem::GetIndex()
+{
+	if(!Index.IsValid() && LoadTask.IsValid())
+	{
+		Index = MoveTemp(LoadTask.GetResult());
+		LoadTask = {};
+	}
+	return Index.Get();
+}
+
+void UMDLeaderboardSubsystem::AppendRecord(TArray<uint8>&& RecordBytes)
+{
+	// Pipe runs one task at a time, so records are appended in order and after loading
+	WritePipe.Launch(TEXT("MDLeaderboardAppend"), [Path = FilePath, RecordBytes = MoveTemp(RecordBytes)]()
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Path, FILEWRITE_Append | FILEWRITE_AllowRead));
+		if(Writer)
+		{
+			Writer->Serialize(const_cast<uint8*>(RecordBytes.GetData()), RecordBytes.Num());
+		}
+		else
+		{
+			UE_LOGFMT(LogTemp, Warning, "Leaderboard: failed to append to {Path}.", Path);
+		}
+	});
+}
+
+FString UMDLeaderboardSubsystem::GetPlayerKey(const AMDPlayerState& PlayerState)
+{
+	// Names are given by join order (PlayerN), only the net id identifies a returning player. Players without one are not tracked.
+	const FUniqueNetIdRepl& UniqueId = PlayerState.GetUniqueId();
+	return UniqueId.IsValid() ? UniqueId.ToString() : FString();
+}
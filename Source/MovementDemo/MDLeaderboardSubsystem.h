@@ -0,0 +1,160 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Pipe.h"
+#include "MDLeaderboardSubsystem.generated.h"
+
+class AMDPlayerState;
+
+// All time stats of one player on one course
+struct FMDLeaderboardEntry
+{
+	// Unique net id of the player
+	FString PlayerKey;
+
+	// Name the player had when setting the best time
+	FString PlayerName;
+
+	// INDEX_NONE if never completed
+	int32 BestTimeMs = INDEX_NONE;
+
+	int32 TotalWins = 0;
+};
+
+/**
+ * In-memory leaderboard of a course. Entries are found by player key trough a map,
+ * ranks are kept in an array sorted by best time, so rank of a player is a binary search and top N is the front of the array.
+ */
+class FMDLeaderboardIndex
+{
+public:
+
+	// Number of records the file was built from. Used to decide when to compact it.
+	int32 NumRecords = 0;
+
+	// File was missing or damaged, appending to it would put records where loading can't reach them
+	bool bNeedsRewrite = false;
+
+	const FMDLeaderboardEntry* Find(const FString& PlayerKey) const;
+
+	// Returns true if the time was better than the stored one. Ranks are only kept sorted if bKeepSorted is set, loading sorts once at the end.
+	bool ApplyBestTime(const FString& PlayerKey, const FString& PlayerName, int32 TimeMs, bool bKeepSorted);
+
+	void ApplyWins(const FString& PlayerKey, int32 Delta);
+
+	void SortRanks();
+
+	// 0 is the fastest, INDEX_NONE if player has no time
+	int32 GetRank(const FString& PlayerKey) const;
+
+	void GetTop(int32 Count, TArray<FMDLeaderboardEntry>& OutEntries) const;
+
+	int32 GetNumEntries() const { return Entries.Num(); }
+
+	int32 GetNumRanked() const { return Ranks.Num(); }
+
+	// Reads the append-only file. Missing file is an empty leaderboard. Stops at a partially written last record.
+	static TUniquePtr<FMDLeaderboardIndex> Load(const FString& Path);
+
+	// Writes one record per entry, so the next load doesn't need to replay the whole history
+	bool SaveCompacted(const FString& Path) const;
+
+private:
+
+	struct FRank
+	{
+		int32 TimeMs;
+
+		int32 EntryIndex;
+
+		// Equal times are ranked by who got there first
+		bool operator<(const FRank& Other) const
+		{
+			return TimeMs != Other.TimeMs ? TimeMs < Other.TimeMs : EntryIndex < Other.EntryIndex;
+		}
+	};
+
+	TArray<FMDLeaderboardEntry> Entries;
+
+	TMap<FString, int32> EntryIndexByKey;
+
+	// Entries with a best time, fastest first
+	TArray<FRank> Ranks;
+
+	int32 FindOrAddEntry(const FString& PlayerKey);
+};
+
+/**
+ * Server side WorldSubsystem that keeps all time best times and wins of the current course (map), also across disconnects and server restarts.
+ * 1. Everything is stored in Saved/Leaderboards/<Map>.mdlb as an append-only list of records. New best time or win adds one small record.
+ * 2. File is read and indexed on a background task when the world is created, so parsing overlaps with level loading. OnWorldBeginPlay waits for it.
+ *    If the file has lots of history compared to number of players, it's rewritten with one record per player during the load.
+ * 3. Records are serialized on game thread and appended to the file on WritePipe, so SetGoalIsReached never waits for disk.
+ *    Pipe runs its tasks one at a time in order, so loading and writes never overlap.
+ * 4. Returning players get their best time and total wins back when they join. Their wins are all time totals, so AMDGameModeBase::ResetWins skips them.
+ *    Players without unique net id are not tracked, their wins are still reset on join.
+ * MD.Leaderboard [Count=10] prints the top of the current course.
+ */
+UCLASS(Config = Game)
+class MOVEMENTDEMO_API UMDLeaderboardSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	void ReportBestTime(const AMDPlayerState& PlayerState, double Time);
+
+	// Delta is negative when a win is taken back, see AMDGameModeBase::TryGiveWinToPlayer
+	void ReportWins(const AMDPlayerState& PlayerState, int32 Delta);
+
+	// Gives joining player their best time and wins from earlier sessions. Players without unique net id are skipped by all of these.
+	void RestorePlayer(AMDPlayerState& PlayerState);
+
+	// True if player's wins are kept here, so they should not be reset
+	bool IsTrackingPlayer(const AMDPlayerState& PlayerState);
+
+	// 0 is the fastest, INDEX_NONE if player has no time on this course
+	int32 GetRank(const AMDPlayerState& PlayerState);
+
+	void GetTopEntries(int32 Count, TArray<FMDLeaderboardEntry>& OutEntries);
+
+	void DumpTop(int32 Count);
+
+protected:
+
+	UPROPERTY(Config)
+	bool bEnableLeaderboard = true;
+
+	// Compact the file on load when it has this many times more records than players
+	UPROPERTY(Config)
+	int32 CompactRecordsPerEntry = 4;
+
+	FString FilePath;
+
+	UE::Tasks::FPipe WritePipe{ TEXT("MDLeaderboardWritePipe") };
+
+	UE::Tasks::TTask<TUniquePtr<FMDLeaderboardIndex>> LoadTask;
+
+	TUniquePtr<FMDLeaderboardIndex> Index;
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	// Waits for the load task if it's still running. Returns null if leaderboard is disabled.
+	FMDLeaderboardIndex* GetIndex();
+
+	void AppendRecord(TArray<uint8>&& RecordBytes);
+
+	// Empty if the player has no valid unique net id
+	static FString GetPlayerKey(const AMDPlayerState& PlayerState);
+};
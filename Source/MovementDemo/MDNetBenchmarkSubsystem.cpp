@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDNetBenchmarkSubsystem.h"
+#include "MovementDemo/MDCharacter.h"
+#include "EngineUtils.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "Logging/StructuredLog.h"
+
+namespace MDNetBenchmark
+{
+	UMDNetBenchmarkSubsystem* GetSubsystem(UWorld* World)
+	{
+		auto* Subsystem = World ? World->GetSubsystem<UMDNetBenchmarkSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			UE_LOGFMT(LogTemp, Warning, "Net benchmark is only available on server.");
+		}
+		return Subsystem;
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs SpawnRacersCmd(
+		TEXT("MD.NetBenchmark.SpawnRacers"),
+		TEXT("Spawns bot racers for replication benchmark. Usage: MD.NetBenchmark.SpawnRacers [Count=64]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (auto* Subsystem = GetSubsystem(World))
+			{
+				Subsystem->SpawnRacers(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 64);
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs MeasureCmd(
+		TEXT("MD.NetBenchmark.Measure"),
+		TEXT("Measures net driver TickFlush time. Usage: MD.NetBenchmark.Measure [Seconds=10]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (auto* Subsystem = GetSubsystem(World))
+			{
+				Subsystem->StartMeasure(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.0f);
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs ClearCmd(
+		TEXT("MD.NetBenchmark.Clear"),
+		TEXT("Destroys bot racers spawned for replication benchmark."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (auto* Subsystem = GetSubsystem(World))
+			{
+				Subsystem->ClearRacers();
+			}
+		}));
+}
+
+bool UMDNetBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	const UWorld* World = CastChecked<UWorld>(Outer);
+	return World->GetNetMode() < NM_Client; // will be created in standalone, dedicated servers, and listen servers
+}
+
+void UMDNetBenchmarkSubsystem::Deinitialize()
+{
+	StopMeasure();
+	Super::Deinitialize();
+}
+
+void UMDNetBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double Time = GetWorld()->GetTimeSeconds();
+	for (int32 Index = 0; Index < BotRacers.Num(); ++Index)
+	{
+		auto* Bot = BotRacers[Index].Get();
+		if (!IsValid(Bot))
+		{
+			continue;
+		}
+
+		// Run tangent to a circle, every bot has different phase
+		const double Angle = Time + Index * (UE_TWO_PI / BotRacers.Num());
+		Bot->AddMovementInput(FVector(-FMath::Sin(Angle), FMath::Cos(Angle), 0.0), 1.0f, true);
+	}
+
+	if (MeasureEndTime > 0.0 && FPlatformTime::Seconds() >= MeasureEndTime)
+	{
+		StopMeasure();
+	}
+}
+
+TStatId UMDNetBenchmarkSubsystem::GetStatId() const
+{
+	return UObject::GetStatID();
+}
+
+void UMDNetBenchmarkSubsystem::SpawnRacers(int32 Count)
+{
+	UWorld* World = GetWorld();
+	const auto* GM = World->GetAuthGameMode();
+	UClass* PawnClass = GM ? GM->GetDefaultPawnClassForController(nullptr) : nullptr;
+	if (!PawnClass || !PawnClass->IsChildOf(AMDCharacter::StaticClass()))
+	{
+		UE_LOGFMT(LogTemp, Warning, "Net benchmark needs MDCharacter as default pawn class.");
+		return;
+	}
+
+	FVector Center = FVector::ZeroVector;
+	for (const auto* PlayerStart : TActorRange<APlayerStart>(World))
+	{
+		Center = PlayerStart->GetActorLocation();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const double Angle = Index * (UE_TWO_PI / Count);
+		const FVector Location = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0) * BotCircleRadius;
+		if (auto* Bot = World->SpawnActor<AMDCharacter>(PawnClass, Location, FRotator::ZeroRotator, SpawnParams))
+		{
+			// No controller, movement is driven from Tick
+			Bot->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+			BotRacers.Add(Bot);
+		}
+	}
+
+	UE_LOGFMT(LogTemp, Log, "Net benchmark: {0} bot racers.", BotRacers.Num());
+}
+
+void UMDNetBenchmarkSubsystem::ClearRacers()
+{
+	for (auto& Bot : BotRacers)
+	{
+		if (IsValid(Bot))
+		{
+			Bot->Destroy();
+		}
+	}
+	BotRacers.Reset();
+}
+
+void UMDNetBenchmarkSubsystem::StartMeasure(float Seconds)
+{
+	StopMeasure();
+
+	UWorld* World = GetWorld();
+	if (!GetNetDriver())
+	{
+		UE_LOGFMT(LogTemp, Warning, "Net benchmark: no net driver, start a listen or dedicated server first.");
+		return;
+	}
+
+	TotalTickFlushTime = 0.0;
+	NumMeasuredFrames = 0;
+	MeasureEndTime = FPlatformTime::Seconds() + Seconds;
+
+	// Multicast delegates are broadcast from last bound to first, so this runs just before net driver's TickFlush, and PostTickFlush right after it
+	TickFlushHandle = World->OnTickFlush().AddUObject(this, &ThisClass::OnTickFlush);
+	PostTickFlushHandle = World->OnPostTickFlush().AddUObject(this, &ThisClass::OnPostTickFlush);
+}
+
+UNetDriver* UMDNetBenchmarkSubsystem::GetNetDriver() const
+{
+	return GetWorld()->GetNetDriver();
+}
+
+void UMDNetBenchmarkSubsystem::OnTickFlush(float DeltaSeconds)
+{
+	TickFlushStartTime = FPlatformTime::Seconds();
+}
+
+void UMDNetBenchmarkSubsystem::OnPostTickFlush()
+{
+	if (TickFlushStartTime <= 0.0)
+	{
+		return;
+	}
+
+	TotalTickFlushTime += FPlatformTime::Seconds() - TickFlushStartTime;
+	TickFlushStartTime = 0.0;
+	++NumMeasuredFrames;
+}
+
+void UMDNetBenchmarkSubsystem::StopMeasure()
+{
+	UWorld* World = GetWorld();
+	if (!TickFlushHandle.IsValid() || !World)
+	{
+		return;
+	}
+
+	World->OnTickFlush().Remove(TickFlushHandle);
+	World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	TickFlushHandle.Reset();
+	PostTickFlushHandle.Reset();
+	MeasureEndTime = 0.0;
+
+	if (NumMeasuredFrames == 0)
+	{
+		return;
+	}
+
+	// Iris doesn't use the network object list, so count replicated actors the same way for both
+	int32 NumReplicatedActors = 0;
+	for (const AActor* Actor : TActorRange<AActor>(World))
+	{
+		if (Actor->GetIsReplicated())
+		{
+			++NumReplicatedActors;
+		}
+	}
+
+	const auto* NetDriver = GetNetDriver();
+	const bool bIsUsingIris = NetDriver && NetDriver->IsUsingIrisReplication();
+	const double AverageFlushMs = TotalTickFlushTime * 1000.0 / NumMeasuredFrames;
+	const double MicrosecondsPerActor = NumReplicatedActors > 0 ? AverageFlushMs * 1000.0 / NumReplicatedActors : 0.0;
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	UE_LOGFMT(LogTemp, Log, "Net benchmark ({0}): {1} frames, {2} connections, {3} bots, TickFlush avg {4} ms, {5} replicated actors, {6} us per actor",
+		bIsUsingIris ? TEXT("Iris") : TEXT("Generic"), NumMeasuredFrames, NumConnections, BotRacers.Num(), AverageFlushMs, NumReplicatedActors, MicrosecondsPerActor);
+}
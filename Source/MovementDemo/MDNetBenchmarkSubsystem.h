@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MDNetBenchmarkSubsystem.generated.h"
+
+class AMDCharacter;
+class UNetDriver;
+
+/**
+ * Server only WorldSubsystem for measuring replication cost. Same measurement can be run with and without Iris (-UseIrisReplication=1) to compare them.
+ * MD.NetBenchmark.SpawnRacers [Count=64] spawns bot racers that run in circles around the first PlayerStart, so they are always dirty.
+ * MD.NetBenchmark.Measure [Seconds=10] logs average net driver TickFlush time, and time per replicated actor.
+ * MD.NetBenchmark.Clear destroys the bots.
+ */
+UCLASS()
+class MOVEMENTDEMO_API UMDNetBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	void SpawnRacers(int32 Count);
+
+	void ClearRacers();
+
+	void StartMeasure(float Seconds);
+
+protected:
+
+	UPROPERTY()
+	TArray<TObjectPtr<AMDCharacter>> BotRacers;
+
+	// Radius of the circle bots are running
+	float BotCircleRadius = 800.0f;
+
+	double MeasureEndTime = 0.0;
+
+	double TickFlushStartTime = 0.0;
+
+	double TotalTickFlushTime = 0.0;
+
+	int32 NumMeasuredFrames = 0;
+
+	FDelegateHandle TickFlushHandle;
+
+	FDelegateHandle PostTickFlushHandle;
+
+	UNetDriver* GetNetDriver() const;
+
+	void OnTickFlush(float DeltaSeconds);
+
+	void OnPostTickFlush();
+
+	void StopMeasure();
+};
@@ -4,42 +4,66 @@
 #include "MovementDemo/MDPlayerAnimInstance.h"
 #include "MovementDemo/MDCharacter.h"
 #include "MovementDemo/MDCharacterMovementComponent.h"
+#include "MovementDemo/MDGhostRacer.h"
 
 UMDPlayerAnimInstance::UMDPlayerAnimInstance()
 {
 	bUseMultiThreadedAnimationUpdate = true;
+	bSkipUpdate = false;
+	bReducedWork = false;
 }
 
 void UMDPlayerAnimInstance::NativeInitializeAnimation()
 {
+	bSkipUpdate = IsRunningDedicatedServer();
+
 	if(auto* MDCharacter = Cast<AMDCharacter>(GetOwningActor()))
 	{
 		MyPawn = MDCharacter;
 		MoveComp = CastChecked<UMDCharacterMovementComponent>(MyPawn->GetCharacterMovement());
+		AnimSnapshot = &MoveComp->GetAnimSnapshot();
+	}
+	else if(const auto* Ghost = Cast<AMDGhostRacer>(GetOwningActor()))
+	{
+		AnimSnapshot = &Ghost->GetAnimSnapshot();
+		// Ghost doesn't need IK or procedural animation
+		bReducedWork = true;
 	}
 }
 
 void UMDPlayerAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 {
-	if(!IsValid(MyPawn))
+	if(bSkipUpdate)
 	{
-		NativeInitializeAnimation();
 		return;
 	}
 
-	// Gather data in game thread
-	Velocity = MoveComp->GetLastUpdateVelocity();
-	bIsFalling = MoveComp->IsFalling();
-	bIsWallRunning = MoveComp->IsWallRunning();
-	bIsCrouching = MoveComp->IsCrouching();
-	bIsSliding = MyPawn->IsSliding();
-	bIsMantling = MyPawn->IsMantling();
-	AimRotation = MyPawn->GetBaseAimRotation();
-	PawnRotation = MyPawn->GetActorRotation();
+	if(!AnimSnapshot)
+	{
+		NativeInitializeAnimation();
+		return;
+	}
 }
 
 void UMDPlayerAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
 {
+	if(bSkipUpdate || !AnimSnapshot)
+	{
+		return;
+	}
+
+	// Movement component published this at the end of its tick, mesh ticks after it. Ghost publishes before mesh tick.
+	const FMDAnimSnapshot& Snapshot = *AnimSnapshot;
+	Velocity = Snapshot.Velocity;
+	AimRotation = Snapshot.AimRotation;
+	PawnRotation = Snapshot.PawnRotation;
+	WallRunSide = Snapshot.WallRunSide;
+	bIsFalling = Snapshot.bIsFalling;
+	bIsWallRunning = Snapshot.bIsWallRunning;
+	bIsCrouching = Snapshot.bIsCrouching;
+	bIsSliding = Snapshot.bIsSliding;
+	bIsMantling = Snapshot.bIsMantling;
+
 	// Process data in worker thread
 	Speed = Velocity.Size();
 	bIsMoving = Speed >= 5.0;
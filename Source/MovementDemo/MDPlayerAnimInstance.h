@@ -4,15 +4,19 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "MovementDemo/MDProxyState.h"
 #include "MDPlayerAnimInstance.generated.h"
 
 class AMDCharacter;
 class UMDCharacterMovementComponent;
+struct FMDAnimSnapshot;
 
 /**
  * Threaded animation updates for MDCharacter.
  * AnimBP Event Graph is empty. Only Anim Graph has nodes.
  * All IK's and procedural animation is implemented inside Control Rig named CR_Player, which can be found in Blueprints/Player/ folder.
+ * Dedicated server skips gathering data, see AMDCharacter::PostInitializeComponents.
+ * Also animates AMDGhostRacer, which publishes the same snapshot as the movement component from its recording.
  */
 UCLASS()
 class MOVEMENTDEMO_API UMDPlayerAnimInstance : public UAnimInstance
@@ -25,14 +29,17 @@ public:
 
 	virtual void NativeInitializeAnimation() override;
 
-	// Native update override point. It is usually a good idea to simply gather data in this step and 
-	// for the bulk of the work to be done in NativeThreadSafeUpdateAnimation.
+	// Only makes sure we have the pawn. Data is gathered by UMDCharacterMovementComponent, see FMDAnimSnapshot.
 	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 
 	// Native thread safe update override point. Executed on a worker thread just prior to graph update 
 	// for linked anim instances, only called when the hosting node(s) are relevant.
+	// Reads movement component's anim snapshot and derives the rest from it.
 	virtual void NativeThreadSafeUpdateAnimation(float DeltaSeconds) override;
 
+	// Set by UMDSkeletalMeshComponent when animation budget allocator is under pressure
+	void SetReducedWork(bool bNewValue) { bReducedWork = bNewValue; }
+
 protected:
 
 	UPROPERTY()
@@ -41,6 +48,12 @@ protected:
 	UPROPERTY()
 	UMDCharacterMovementComponent* MoveComp;
 
+	// Movement component's or ghost's snapshot, read on worker thread
+	const FMDAnimSnapshot* AnimSnapshot = nullptr;
+
+	// Nothing is rendered on dedicated server, only montages need to tick
+	uint32 bSkipUpdate:1;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Booleans")
 	uint32 bIsFalling:1;
 
@@ -62,9 +75,16 @@ protected:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Booleans")
 	uint32 bIsCrouching:1;
 
+	// AnimBP can skip expensive nodes like Control Rig when this is set
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Booleans")
+	uint32 bReducedWork:1;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Locomotion")
 	FVector Velocity;
 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Locomotion")
+	EMDWallRunSide WallRunSide;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Locomotion")
 	float Speed;
 
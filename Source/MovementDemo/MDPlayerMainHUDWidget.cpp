@@ -4,14 +4,33 @@
 #include "MovementDemo/MDPlayerMainHUDWidget.h"
 #include "MovementDemo/MDPlayerState.h"
 #include "MovementDemo/MDRemotePlayerHUDWidget.h"
+#include "MovementDemo/MDTimeText.h"
 #include "Components/TextBlock.h"
+#include "Components/ListView.h"
 #include "Components/VerticalBox.h"
-#include "Kismet/KismetTextLibrary.h"
 
 UMDPlayerMainHUDWidget::UMDPlayerMainHUDWidget(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 }
 
+void UMDPlayerMainHUDWidget::NativeOnInitialized()
+{
+	Super::NativeOnInitialized();
+
+	if(!TimeText_CurrentMatchTime)
+	{
+		TimeText_CurrentMatchTime = UMDTimeText::ReplaceTextBlock(*this, TextBlock_CurrentMatchTime);
+	}
+	if(!TimeText_BestTime)
+	{
+		TimeText_BestTime = UMDTimeText::ReplaceTextBlock(*this, TextBlock_BestTime);
+	}
+	if(!TimeText_LastTime)
+	{
+		TimeText_LastTime = UMDTimeText::ReplaceTextBlock(*this, TextBlock_LastTime);
+	}
+}
+
 void UMDPlayerMainHUDWidget::SetLocalPlayerName(const FString& Name)
 {
 	if(ensure(TextBlock_PlayerName))
@@ -22,28 +41,25 @@ void UMDPlayerMainHUDWidget::SetLocalPlayerName(const FString& Name)
 
 void UMDPlayerMainHUDWidget::SetCurrentMatchTimeText(double Time)
 {
-	if(ensure(TextBlock_CurrentMatchTime))
+	if(ensure(TimeText_CurrentMatchTime))
 	{
-		FText AsText = UKismetTextLibrary::Conv_DoubleToText(Time, HalfToEven, false, true, 1, 10, 3, 3);
-		TextBlock_CurrentMatchTime->SetText(AsText);
+		TimeText_CurrentMatchTime->SetTime(Time);
 	}
 }
 
 void UMDPlayerMainHUDWidget::SetLocalBestTime(double Time)
 {
-	if(ensure(TextBlock_BestTime))
+	if(ensure(TimeText_BestTime))
 	{
-		FText AsText = UKismetTextLibrary::Conv_DoubleToText(Time, HalfToEven, false, true, 1, 10, 3, 3);
-		TextBlock_BestTime->SetText(AsText);
+		TimeText_BestTime->SetTime(Time);
 	}
 }
 
 void UMDPlayerMainHUDWidget::SetLocalLastTime(double Time)
 {
-	if(ensure(TextBlock_LastTime))
+	if(ensure(TimeText_LastTime))
 	{
-		FText AsText = UKismetTextLibrary::Conv_DoubleToText(Time, HalfToEven, false, true, 1, 10, 3, 3);
-		TextBlock_LastTime->SetText(AsText);
+		TimeText_LastTime->SetTime(Time);
 	}
 }
 
@@ -57,47 +73,79 @@ void UMDPlayerMainHUDWidget::SetLocalWins(int32 Count)
 
 void UMDPlayerMainHUDWidget::CreateOrRefreshWidgetForRemotePlayer(AMDPlayerState* PlayerState)
 {
-	if (ensure(VerticalBox_RemotePlayers))
+	if(ListView_RemotePlayers)
 	{
-		auto RemoteWidgets = VerticalBox_RemotePlayers->GetAllChildren();
+		bool bAlreadyListed = false;
+		ListedRemotePlayers.Add(PlayerState, &bAlreadyListed);
+		if(!bAlreadyListed)
+		{
+			ListView_RemotePlayers->AddItem(PlayerState);
+		}
+		// Only rows on screen have a widget, others are refreshed when they scroll into view
+		else if(auto* Entry = ListView_RemotePlayers->GetEntryWidgetFromItem<UMDRemotePlayerHUDWidget>(PlayerState))
+		{
+			Entry->Refresh();
+		}
+		return;
+	}
 
+	if (ensure(VerticalBox_RemotePlayers))
+	{
 		UMDRemotePlayerHUDWidget* Widget = nullptr;
 
 		// If it exists, grab it
-		if (const auto* PtrToPtr = RemoteWidgets.FindByPredicate([PlayerState](const UWidget* W) { return CastChecked<UMDRemotePlayerHUDWidget>(W)->OwningPlayerState.Get() == PlayerState; }))
+		if (auto* const* Found = RemotePlayerWidgets.Find(PlayerState))
 		{
-			Widget = CastChecked<UMDRemotePlayerHUDWidget>(*PtrToPtr);
+			Widget = *Found;
 		}
-		// Doesn't exist, need to create new
+		// Doesn't exist, take one from pool or create new
 		else
 		{
-			if (ensure(RemotePlayerWidgetClass))
+			Widget = AcquireRemotePlayerWidget();
+			if (Widget)
 			{
-				Widget = CreateWidget<UMDRemotePlayerHUDWidget>(GetOwningPlayer(), RemotePlayerWidgetClass);
-				Widget->OwningPlayerState = PlayerState;
-				check(!RemoteWidgets.Contains(Widget));
+				RemotePlayerWidgets.Add(PlayerState, Widget);
 				VerticalBox_RemotePlayers->AddChildToVerticalBox(Widget);
 			}
 		}
 		// At this point, we should have a valid widget
 		if (ensure(IsValid(Widget)))
 		{
-			Widget->SetPlayerName(PlayerState->GetPlayerName());
-			Widget->SetBestTime(PlayerState->GetBestCompletedTime());
-			Widget->SetLastTime(PlayerState->GetLastCompletedTime());
-			Widget->SetWins(PlayerState->GetWinCount());
+			Widget->SetOwningPlayerState(PlayerState);
 		}
 	}
 }
 
 void UMDPlayerMainHUDWidget::DestroyWidgetForRemotePlayer(AMDPlayerState* PlayerState)
 {
-	auto RemoteWidgets = VerticalBox_RemotePlayers->GetAllChildren();
+	if(ListView_RemotePlayers)
+	{
+		if(ListedRemotePlayers.Remove(PlayerState) > 0)
+		{
+			ListView_RemotePlayers->RemoveItem(PlayerState);
+		}
+		return;
+	}
 
-	if (const auto* PtrToPtr = RemoteWidgets.FindByPredicate([PlayerState](const UWidget* W){ return CastChecked<UMDRemotePlayerHUDWidget>(W)->OwningPlayerState.Get() == PlayerState; }))
+	UMDRemotePlayerHUDWidget* Widget = nullptr;
+	if (RemotePlayerWidgets.RemoveAndCopyValue(PlayerState, Widget))
 	{
-		auto* Widget = CastChecked<UMDRemotePlayerHUDWidget>(*PtrToPtr);
-		VerticalBox_RemotePlayers->RemoveChild(Widget);
 		Widget->RemoveFromParent();
+		Widget->OwningPlayerState = nullptr;
+		FreeRemotePlayerWidgets.Add(Widget);
+	}
+}
+
+UMDRemotePlayerHUDWidget* UMDPlayerMainHUDWidget::AcquireRemotePlayerWidget()
+{
+	if (FreeRemotePlayerWidgets.Num() > 0)
+	{
+		return FreeRemotePlayerWidgets.Pop(false);
+	}
+
+	if (ensure(RemotePlayerWidgetClass))
+	{
+		return CreateWidget<UMDRemotePlayerHUDWidget>(GetOwningPlayer(), RemotePlayerWidgetClass);
 	}
+	return nullptr;
 }
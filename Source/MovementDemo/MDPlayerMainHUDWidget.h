@@ -4,15 +4,22 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "UObject/ObjectKey.h"
 #include "MDPlayerMainHUDWidget.generated.h"
 
 class UMDRemotePlayerHUDWidget;
+class UMDTimeText;
 class UTextBlock;
 class UVerticalBox;
+class UListView;
 class AMDPlayerState;
 
 /**
  * MDPlayerMainHUDWidget is the main widget for local player. It also contains widgets for remote players, which are created on demand.
+ * Remote players are shown in ListView_RemotePlayers if the widget blueprint has one. List view only creates rows that are visible and reuses them.
+ * Otherwise they go to VerticalBox_RemotePlayers, with a widget per player found trough a map and returned to a pool when player leaves.
+ * Times are shown with UMDTimeText, which doesn't allocate when match time updates or is painted.
+ * If the widget blueprint still has text blocks for times, they are replaced with time texts when the widget is initialized.
  */
 UCLASS()
 class MOVEMENTDEMO_API UMDPlayerMainHUDWidget : public UUserWidget
@@ -41,24 +48,52 @@ public:
 
 protected:
 
+	virtual void NativeOnInitialized() override;
+
 	UPROPERTY(EditDefaultsOnly)
 	TSubclassOf<UMDRemotePlayerHUDWidget> RemotePlayerWidgetClass;
 
 	UPROPERTY(meta = (BindWidget))
 	UTextBlock* TextBlock_PlayerName;
 
-	UPROPERTY(meta=(BindWidget))
+	UPROPERTY(meta=(BindWidgetOptional))
+	UMDTimeText* TimeText_CurrentMatchTime;
+
+	UPROPERTY(meta=(BindWidgetOptional))
+	UMDTimeText* TimeText_BestTime;
+
+	UPROPERTY(meta=(BindWidgetOptional))
+	UMDTimeText* TimeText_LastTime;
+
+	// Older widget blueprints have these instead of the time texts above, they are replaced in NativeOnInitialized
+	UPROPERTY(meta=(BindWidgetOptional))
 	UTextBlock* TextBlock_CurrentMatchTime;
 
-	UPROPERTY(meta=(BindWidget))
+	UPROPERTY(meta=(BindWidgetOptional))
 	UTextBlock* TextBlock_BestTime;
 
-	UPROPERTY(meta = (BindWidget))
+	UPROPERTY(meta = (BindWidgetOptional))
 	UTextBlock* TextBlock_LastTime;
 
 	UPROPERTY(meta = (BindWidget))
 	UTextBlock* TextBlock_Wins;
 
-	UPROPERTY(meta= (BindWidget))
+	// Entry widget class must be UMDRemotePlayerHUDWidget. PlayerStates are the list items.
+	UPROPERTY(meta = (BindWidgetOptional))
+	UListView* ListView_RemotePlayers;
+
+	UPROPERTY(meta= (BindWidgetOptional))
 	UVerticalBox* VerticalBox_RemotePlayers;
+
+	// Widgets in VerticalBox_RemotePlayers. Box keeps them alive.
+	TMap<TObjectKey<AMDPlayerState>, UMDRemotePlayerHUDWidget*> RemotePlayerWidgets;
+
+	// Widgets of players that left, reused for next players that join
+	UPROPERTY(Transient)
+	TArray<UMDRemotePlayerHUDWidget*> FreeRemotePlayerWidgets;
+
+	// Players in ListView_RemotePlayers, so we don't search the list items
+	TSet<TObjectKey<AMDPlayerState>> ListedRemotePlayers;
+
+	UMDRemotePlayerHUDWidget* AcquireRemotePlayerWidget();
 };
@@ -8,8 +8,8 @@
 
 class UTextBlock;
 /**
- * MDPlayerNameWidget is widget that is created on top of every player to show their name inside game world.
- * It is hidden for local player.
+ * MDPlayerNameWidget was created on top of every player to show their name inside game world.
+ * Characters don't use it anymore, names are drawn by AMDHUD::DrawNamePlates. Kept so WBP_PlayerNameWidget still loads.
  */
 UCLASS()
 class MOVEMENTDEMO_API UMDPlayerNameWidget : public UUserWidget
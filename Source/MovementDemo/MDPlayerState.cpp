@@ -2,43 +2,23 @@
 
 
 #include "MovementDemo/MDPlayerState.h"
-#include "MovementDemo/MDCharacter.h"
 #include "MovementDemo/MDGameModeBase.h"
 #include "MovementDemo/MDGameStateBase.h"
-#include "MovementDemo/MDHUD.h"
+#include "MovementDemo/MDGhostSubsystem.h"
+#include "MovementDemo/MDLeaderboardSubsystem.h"
+#include "MovementDemo/MDUIEventRouter.h"
+#include "MovementDemo/MDScoreboard.h"
 #include "Logging/StructuredLog.h"
-#include "Net/UnrealNetwork.h"
-#include "Net/Core/PushModel/PushModel.h"
 
 AMDPlayerState::AMDPlayerState()
 {
 }
 
-void AMDPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-	FDoRepLifetimeParams Params;
-	Params.bIsPushBased = true;
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, BestCompletedTime, Params);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, LastCompletedTime, Params);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, Wins, Params);
-	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, bHasReachedGoal, Params);
-}
-
 void AMDPlayerState::OnRep_PlayerName()
 {
 	Super::OnRep_PlayerName();
 
-	if (auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
-	{
-		LocalHUD->SetNameForPlayer(this);
-	}
-
-	// Update name on the widget on top of the player
-	if(auto* MDCharacter = GetPawn<AMDCharacter>())
-	{
-		MDCharacter->SetNameWidgetText(GetPlayerName());
-	}
+	NotifyUIChanged(EMDPlayerUIChange::Name);
 }
 
 void AMDPlayerState::SetPlayerName(const FString& S)
@@ -47,38 +27,41 @@ void AMDPlayerState::SetPlayerName(const FString& S)
 
 	// Call OnRep manually on server
 	//OnRep_PlayerName();
+
+	// Listen server draws name plates too
+	NotifyUIChanged(EMDPlayerUIChange::Name);
 }
 
-void AMDPlayerState::SetGoalIsReached()
+void AMDPlayerState::SetGoalIsReached(double TimeCompleted)
 {
 	if(HasAuthority() && !bHasReachedGoal)
 	{
 		bHasReachedGoal = true;
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, bHasReachedGoal, this);
-
-		// Call OnRep manually on server
-		OnRep_HasReachedGoal();
+		NotifyHasReachedGoalChanged();
 
 		// Check if we have new best time
 		auto* World = GetWorld();
-		auto* GS = World->GetGameState<AMDGameStateBase>();
-		check(IsValid(GS));
-		double MatchStartTime = GS->GetStartingShotServerTime();
-		double TimeCompleted = World->TimeSince(MatchStartTime);
-
 		if(BestCompletedTime < 0.0 || TimeCompleted < BestCompletedTime)
 		{
 			SetBestCompletedTime(TimeCompleted);
+
+			// Written on a background task
+			if(auto* Leaderboard = World->GetSubsystem<UMDLeaderboardSubsystem>())
+			{
+				Leaderboard->ReportBestTime(*this, TimeCompleted);
+			}
 		}
 
 		// Always set last completed time
 		SetLastCompletedTime(TimeCompleted);
 
+		UpdateScoreboard();
+
 		// Start new match
 		auto* GM = World->GetAuthGameMode<AMDGameModeBase>();
 		check(IsValid(GM));
-		// Try award win to player if we were the first one to complete
-		GM->TryGiveWinToPlayer(this);
+		// Try award win to player if we were the fastest one to complete
+		GM->TryGiveWinToPlayer(this, TimeCompleted);
 
 		if(GM->GetMatchState() == EMDMatchState::OnGoing)
 		{
@@ -87,16 +70,12 @@ void AMDPlayerState::SetGoalIsReached()
 	}
 }
 
-void AMDPlayerState::ResetHasReachedGoal()
+void AMDPlayerState::ClearHasReachedGoalForMatchReset()
 {
-	if(HasAuthority() && bHasReachedGoal)
+	if(bHasReachedGoal)
 	{
 		bHasReachedGoal = false;
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, bHasReachedGoal, this);
-		ForceNetUpdate();
-
-		// Call OnRep manually on server
-		OnRep_HasReachedGoal();
+		NotifyHasReachedGoalChanged();
 	}
 }
 
@@ -105,63 +84,123 @@ void AMDPlayerState::SetWinCount(int32 NewCount)
 	if(HasAuthority())
 	{
 		Wins = NewCount;
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, Wins, this);
+		UpdateScoreboard();
+		NotifyWinsChanged();
+	}
+}
 
-		// Call OnRep manually on server
-		OnRep_Wins();
+void AMDPlayerState::RestoreBestCompletedTime(double Time)
+{
+	if(HasAuthority() && Time > 0.0 && (BestCompletedTime < 0.0 || Time < BestCompletedTime))
+	{
+		SetBestCompletedTime(Time);
+		UpdateScoreboard();
+	}
+}
+
+void AMDPlayerState::ApplyScoreboardEntry(const FMDScoreboardEntry& Entry)
+{
+	if(HasAuthority())
+	{
+		return;
+	}
+
+	const double NewBestTime = FMDScoreboardEntry::DequantizeTime(Entry.BestTimeMs);
+	const double NewLastTime = FMDScoreboardEntry::DequantizeTime(Entry.LastTimeMs);
+	const int32 NewWins = Entry.Wins;
+	const bool bNewHasReachedGoal = Entry.bHasReachedGoal;
+
+	// Same order as server sets them
+	if(bHasReachedGoal != bNewHasReachedGoal)
+	{
+		bHasReachedGoal = bNewHasReachedGoal;
+		NotifyHasReachedGoalChanged();
+	}
+	if(BestCompletedTime != NewBestTime)
+	{
+		BestCompletedTime = NewBestTime;
+		NotifyBestCompletedTimeChanged();
+	}
+	if(LastCompletedTime != NewLastTime)
+	{
+		LastCompletedTime = NewLastTime;
+		NotifyLastCompletedTimeChanged();
+	}
+	if(Wins != NewWins)
+	{
+		Wins = NewWins;
+		NotifyWinsChanged();
 	}
 }
 
 void AMDPlayerState::BeginPlay()
 {
 	Super::BeginPlay();
-	if(auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
+
+	// Scoreboard entry might have replicated before us
+	if(!HasAuthority())
 	{
-		// No need to check if local state, widget will check it anyway
-		LocalHUD->CreateOrRefreshWidgetForRemotePlayer(this);
+		if(auto* GS = GetWorld()->GetGameState<AMDGameStateBase>())
+		{
+			GS->RegisterScoreboardPlayer(*this);
+			if(const auto* Entry = GS->FindScoreboardEntry(GetPlayerId()))
+			{
+				ApplyScoreboardEntry(*Entry);
+			}
+		}
 	}
+
+	// No need to check if local state, HUD will check it anyway
+	NotifyUIChanged(EMDPlayerUIChange::All);
 }
 
 void AMDPlayerState::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	if (auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
+	if (auto* Router = GetWorld()->GetSubsystem<UMDUIEventRouter>())
 	{
 		// No need to check if local state, widget will check it anyway
-		LocalHUD->RemoveWidgetForRemotePlayer(this);
+		Router->NotifyPlayerRemoved(this);
 	}
 }
 
-void AMDPlayerState::OnRep_BestCompletedTime()
+void AMDPlayerState::NotifyBestCompletedTimeChanged()
 {
-	if(auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
+	NotifyUIChanged(EMDPlayerUIChange::BestTime);
+
+	// Best run of the local player becomes the ghost. Server sets this in SetBestCompletedTime, clients get it from the scoreboard.
+	const auto* PC = GetPlayerController();
+	if(PC && PC->IsLocalController())
 	{
-		LocalHUD->SetBestTimeForPlayer(this);
+		if(auto* GhostSubsystem = GetWorld()->GetSubsystem<UMDGhostSubsystem>())
+		{
+			GhostSubsystem->OnLocalBestTimeChanged(BestCompletedTime);
+		}
 	}
 }
 
-void AMDPlayerState::OnRep_LastCompletedTime()
+void AMDPlayerState::NotifyLastCompletedTimeChanged()
 {
-	if (auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
-	{
-		LocalHUD->SetLastTimeForPlayer(this);
-	}
+	NotifyUIChanged(EMDPlayerUIChange::LastTime);
 }
 
-void AMDPlayerState::OnRep_Wins()
+void AMDPlayerState::NotifyWinsChanged()
 {
-	if (auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
-	{
-		LocalHUD->SetWinsForPlayer(this);
-	}
+	NotifyUIChanged(EMDPlayerUIChange::Wins);
+}
+
+void AMDPlayerState::NotifyHasReachedGoalChanged()
+{
+	NotifyUIChanged(EMDPlayerUIChange::ReachedGoal);
 }
 
-void AMDPlayerState::OnRep_HasReachedGoal()
+void AMDPlayerState::NotifyUIChanged(EMDPlayerUIChange Changes)
 {
-	if (auto* LocalHUD = AMDHUD::GetLocalHUD(GetWorld()))
+	// Null on dedicated server
+	if (auto* Router = GetWorld()->GetSubsystem<UMDUIEventRouter>())
 	{
-		LocalHUD->SetPlayerReachedGoal(this);
+		Router->NotifyPlayerChanged(this, Changes);
 	}
 }
 
@@ -170,9 +209,7 @@ void AMDPlayerState::SetBestCompletedTime(double NewTime)
 	if (HasAuthority())
 	{
 		BestCompletedTime = NewTime;
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, BestCompletedTime, this);
-		ForceNetUpdate();
-		OnRep_BestCompletedTime();
+		NotifyBestCompletedTimeChanged();
 	}
 }
 
@@ -181,8 +218,14 @@ void AMDPlayerState::SetLastCompletedTime(double NewTime)
 	if(HasAuthority())
 	{
 		LastCompletedTime = NewTime;
-		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, LastCompletedTime, this);
-		ForceNetUpdate();
-		OnRep_LastCompletedTime();
+		NotifyLastCompletedTimeChanged();
 	}
-}
\ No newline at end of file
+}
+
+void AMDPlayerState::UpdateScoreboard()
+{
+	if(auto* GS = GetWorld()->GetGameState<AMDGameStateBase>())
+	{
+		GS->UpdateScoreboardEntry(*this);
+	}
+}
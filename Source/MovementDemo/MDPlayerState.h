@@ -6,9 +6,14 @@
 #include "GameFramework/PlayerState.h"
 #include "MDPlayerState.generated.h"
 
+struct FMDScoreboardEntry;
+enum class EMDPlayerUIChange : uint8;
+
 /**
- * MDPlayerState contains player specific data which most are replicated.
- * OnReps are used to update widgets / UI.
+ * MDPlayerState contains player specific data.
+ * Stats (times, wins, goal reached) are not replicated by the PlayerState itself. Server writes them to the scoreboard in MDGameStateBase,
+ * and clients get them back trough ApplyScoreboardEntry. This way match end is one small scoreboard delta instead of forced update on every PlayerState.
+ * Stat changes are used to update widgets / UI. They go trough UMDUIEventRouter, which refreshes the HUD once per frame.
  */
 UCLASS()
 class MOVEMENTDEMO_API AMDPlayerState : public APlayerState
@@ -19,15 +24,15 @@ public:
 
 	AMDPlayerState();
 
-	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
-
 	virtual void OnRep_PlayerName() override;
 
 	virtual void SetPlayerName(const FString& S) override;
 
-	void SetGoalIsReached();
+	// TimeCompleted is the race clock when goal was crossed, see UMDCheckpointSubsystem::GetCrossingRaceTime.
+	void SetGoalIsReached(double TimeCompleted);
 
-	void ResetHasReachedGoal();
+	// Called on server and clients by match reset event, see AMDGameStateBase::NotifyMatchReset.
+	void ClearHasReachedGoalForMatchReset();
 
 	double GetBestCompletedTime() const { return BestCompletedTime; }
 
@@ -37,39 +42,42 @@ public:
 
 	void SetWinCount(int32 NewCount);
 
+	// Server only. Best time from an earlier session, see UMDLeaderboardSubsystem.
+	void RestoreBestCompletedTime(double Time);
+
 	bool HasReachedGoal() const { return bHasReachedGoal; }
 
+	// Clients only. Copies replicated stats and notifies HUD about the ones that changed.
+	void ApplyScoreboardEntry(const FMDScoreboardEntry& Entry);
+
 protected:
 
-	UPROPERTY(ReplicatedUsing = OnRep_BestCompletedTime)
 	double BestCompletedTime = -1.0;
 
-	UPROPERTY(ReplicatedUsing = OnRep_LastCompletedTime)
 	double LastCompletedTime = -1.0;
 
-	UPROPERTY(ReplicatedUsing = OnRep_Wins)
 	int32 Wins = 0;
 
-	UPROPERTY(ReplicatedUsing = OnRep_HasReachedGoal)
 	bool bHasReachedGoal = false;
 
 	virtual void BeginPlay() override;
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	UFUNCTION()
-	void OnRep_BestCompletedTime();
+	void NotifyBestCompletedTimeChanged();
+
+	void NotifyLastCompletedTimeChanged();
 
-	UFUNCTION()
-	void OnRep_LastCompletedTime();
+	void NotifyWinsChanged();
 
-	UFUNCTION()
-	void OnRep_Wins();
+	void NotifyHasReachedGoalChanged();
 
-	UFUNCTION()
-	void OnRep_HasReachedGoal();
+	void NotifyUIChanged(EMDPlayerUIChange Changes);
 
 	void SetBestCompletedTime(double NewTime);
 
 	void SetLastCompletedTime(double NewTime);
+
+	// Server only. Pushes current stats to the scoreboard.
+	void UpdateScoreboard();
 };
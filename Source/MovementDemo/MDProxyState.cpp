@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDProxyState.h"
+
+uint16 FMDProxyState::Pack() const
+{
+	return (bIsSliding ? 1 : 0) | (bIsMantling ? 2 : 0) | (static_cast<uint16>(WallRunSide) << 2) | (static_cast<uint16>(ViewYaw) << 4);
+}
+
+void FMDProxyState::Unpack(uint16 Packed)
+{
+	bIsSliding = (Packed & 1) != 0;
+	bIsMantling = (Packed & 2) != 0;
+	const uint8 Side = (Packed >> 2) & 3;
+	WallRunSide = Side <= static_cast<uint8>(EMDWallRunSide::Right) ? static_cast<EMDWallRunSide>(Side) : EMDWallRunSide::None;
+	ViewYaw = static_cast<uint8>(Packed >> 4);
+}
+
+bool FMDProxyState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint16 Packed = 0;
+	if (Ar.IsSaving())
+	{
+		Packed = Pack();
+	}
+
+	Ar.SerializeBits(&Packed, NumPackedBits);
+
+	if (Ar.IsLoading())
+	{
+		Unpack(Packed);
+	}
+
+	bOutSuccess = true;
+	return true;
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MDProxyState.generated.h"
+
+UENUM(BlueprintType)
+enum class EMDWallRunSide : uint8
+{
+	None,
+	Left,
+	Right,
+};
+
+/**
+ * State of MDCharacter that only simulated proxies need. Replicated as one push model property with bit packed NetSerialize, 12 bits in total.
+ * Owner sets these values trough MDCharacter setters, which mark the property dirty only when the packed value actually changes.
+ * Iris sends the same 12 bits with FMDProxyStateNetSerializer, see MDProxyStateNetSerializer.h.
+ */
+USTRUCT()
+struct MOVEMENTDEMO_API FMDProxyState
+{
+	GENERATED_BODY()
+
+	FMDProxyState()
+		: bIsSliding(false)
+		, bIsMantling(false)
+	{
+	}
+
+	uint8 bIsSliding:1;
+
+	uint8 bIsMantling:1;
+
+	EMDWallRunSide WallRunSide = EMDWallRunSide::None;
+
+	// Compressed to 1 byte, see FRotator::CompressAxisToByte
+	uint8 ViewYaw = 0;
+
+	// 1 bit sliding, 1 bit mantling, 2 bits wall run side, 8 bits view yaw
+	static constexpr uint32 NumPackedBits = 12;
+
+	uint16 Pack() const;
+
+	void Unpack(uint16 Packed);
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FMDProxyState& Other) const
+	{
+		return bIsSliding == Other.bIsSliding && bIsMantling == Other.bIsMantling && WallRunSide == Other.WallRunSide && ViewYaw == Other.ViewYaw;
+	}
+
+	bool operator!=(const FMDProxyState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FMDProxyState> : public TStructOpsTypeTraitsBase2<FMDProxyState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
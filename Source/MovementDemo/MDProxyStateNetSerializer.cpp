@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDProxyStateNetSerializer.h"
+#include "MovementDemo/MDProxyState.h"
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+
+namespace UE::Net
+{
+
+struct FMDProxyStateNetSerializer
+{
+	static const uint32 Version = 0;
+
+	typedef FMDProxyState SourceType;
+	// FMDProxyState::Pack
+	typedef uint16 QuantizedType;
+	typedef FMDProxyStateNetSerializerConfig ConfigType;
+
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+private:
+
+	class FNetSerializerRegistryDelegates final : private UE::Net::FNetSerializerRegistryDelegates
+	{
+	public:
+		virtual ~FNetSerializerRegistryDelegates();
+
+	private:
+		virtual void OnPreFreezeNetSerializerRegistry() override;
+	};
+
+	static FMDProxyStateNetSerializer::FNetSerializerRegistryDelegates NetSerializerRegistryDelegates;
+};
+
+UE_NET_IMPLEMENT_SERIALIZER(FMDProxyStateNetSerializer);
+
+const FMDProxyStateNetSerializer::ConfigType FMDProxyStateNetSerializer::DefaultConfig;
+FMDProxyStateNetSerializer::FNetSerializerRegistryDelegates FMDProxyStateNetSerializer::NetSerializerRegistryDelegates;
+
+static const FName PropertyNetSerializerRegistry_NAME_MDProxyState("MDProxyState");
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MDProxyState, FMDProxyStateNetSerializer);
+
+void FMDProxyStateNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType Value = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	Context.GetBitStreamWriter()->WriteBits(Value, FMDProxyState::NumPackedBits);
+}
+
+void FMDProxyStateNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	Target = static_cast<QuantizedType>(Context.GetBitStreamReader()->ReadBits(FMDProxyState::NumPackedBits));
+}
+
+void FMDProxyStateNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	Target = Source.Pack();
+}
+
+void FMDProxyStateNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const QuantizedType Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+	Target.Unpack(Source);
+}
+
+bool FMDProxyStateNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+	{
+		return *reinterpret_cast<const QuantizedType*>(Args.Source0) == *reinterpret_cast<const QuantizedType*>(Args.Source1);
+	}
+
+	return *reinterpret_cast<const SourceType*>(Args.Source0) == *reinterpret_cast<const SourceType*>(Args.Source1);
+}
+
+bool FMDProxyStateNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	return Source.WallRunSide <= EMDWallRunSide::Right;
+}
+
+FMDProxyStateNetSerializer::FNetSerializerRegistryDelegates::~FNetSerializerRegistryDelegates()
+{
+	UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MDProxyState);
+}
+
+void FMDProxyStateNetSerializer::FNetSerializerRegistryDelegates::OnPreFreezeNetSerializerRegistry()
+{
+	UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_MDProxyState);
+}
+
+}
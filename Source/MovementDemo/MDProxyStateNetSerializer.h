@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Iris/Serialization/NetSerializer.h"
+#include "MDProxyStateNetSerializer.generated.h"
+
+USTRUCT()
+struct FMDProxyStateNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+namespace UE::Net
+{
+
+/**
+ * Iris serializer for FMDProxyState. Quantized state is the same 12 bits FMDProxyState::NetSerialize sends with the generic replication system.
+ * Registered for MDProxyState structs, so Iris doesn't fall back to wrapping NetSerialize.
+ */
+UE_NET_DECLARE_SERIALIZER(FMDProxyStateNetSerializer, MOVEMENTDEMO_API);
+
+}
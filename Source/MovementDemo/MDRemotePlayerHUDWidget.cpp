@@ -2,8 +2,48 @@
 
 
 #include "MovementDemo/MDRemotePlayerHUDWidget.h"
+#include "MovementDemo/MDPlayerState.h"
+#include "MovementDemo/MDTimeText.h"
 #include "Components/TextBlock.h"
-#include "Kismet/KismetTextLibrary.h"
+
+void UMDRemotePlayerHUDWidget::SetOwningPlayerState(AMDPlayerState* PlayerState)
+{
+	OwningPlayerState = PlayerState;
+	Refresh();
+}
+
+void UMDRemotePlayerHUDWidget::Refresh()
+{
+	if(const auto* PlayerState = OwningPlayerState.Get())
+	{
+		SetPlayerName(PlayerState->GetPlayerName());
+		SetBestTime(PlayerState->GetBestCompletedTime());
+		SetLastTime(PlayerState->GetLastCompletedTime());
+		SetWins(PlayerState->GetWinCount());
+	}
+}
+
+void UMDRemotePlayerHUDWidget::NativeOnInitialized()
+{
+	Super::NativeOnInitialized();
+
+	if(!TimeText_BestTime)
+	{
+		TimeText_BestTime = UMDTimeText::ReplaceTextBlock(*this, TextBlock_BestTime);
+	}
+	if(!TimeText_LastTime)
+	{
+		TimeText_LastTime = UMDTimeText::ReplaceTextBlock(*this, TextBlock_LastTime);
+	}
+}
+
+void UMDRemotePlayerHUDWidget::NativeOnListItemObjectSet(UObject* ListItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(ListItemObject);
+
+	// List view reuses entries, so this is called again with other players as rows scroll in
+	SetOwningPlayerState(CastChecked<AMDPlayerState>(ListItemObject));
+}
 
 void UMDRemotePlayerHUDWidget::SetPlayerName(const FString& Name)
 {
@@ -15,33 +55,19 @@ void UMDRemotePlayerHUDWidget::SetPlayerName(const FString& Name)
 
 void UMDRemotePlayerHUDWidget::SetBestTime(double Time)
 {
-	if(ensure(TextBlock_BestTime))
+	// Zero means player hasn't completed the track yet
+	if(ensure(TimeText_BestTime))
 	{
-		if(Time > 0.0)
-		{
-			FText AsText = UKismetTextLibrary::Conv_DoubleToText(Time, HalfToEven, false, true, 1, 10, 3, 3);
-			TextBlock_BestTime->SetText(AsText);
-		}
-		else
-		{
-			TextBlock_BestTime->SetText(FText::GetEmpty());
-		}
+		TimeText_BestTime->SetTime(Time, true);
 	}
 }
 
 void UMDRemotePlayerHUDWidget::SetLastTime(double Time)
 {
-	if(ensure(TextBlock_LastTime))
+	// Zero means player hasn't completed the track yet
+	if(ensure(TimeText_LastTime))
 	{
-		if(Time > 0.0)
-		{
-			FText AsText = UKismetTextLibrary::Conv_DoubleToText(Time, HalfToEven, false, true, 1, 10, 3, 3);
-			TextBlock_LastTime->SetText(AsText);
-		}
-		else
-		{
-			TextBlock_LastTime->SetText(FText::GetEmpty());
-		}
+		TimeText_LastTime->SetTime(Time, true);
 	}
 }
 
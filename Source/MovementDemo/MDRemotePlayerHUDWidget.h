@@ -4,16 +4,20 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "Blueprint/IUserObjectListEntry.h"
 #include "MDRemotePlayerHUDWidget.generated.h"
 
 class AMDPlayerState;
 class UTextBlock;
+class UMDTimeText;
 
 /**
  * MDRemotePlayerHUDWidget is a widget that is created for each remote player. 
+ * Best and last times are shown with UMDTimeText. Text blocks of older widget blueprints are replaced with time texts when the widget is initialized.
+ * Instances are reused for other players, either by UMDPlayerMainHUDWidget's pool or by a list view, which passes the PlayerState as list item.
  */
 UCLASS()
-class MOVEMENTDEMO_API UMDRemotePlayerHUDWidget : public UUserWidget
+class MOVEMENTDEMO_API UMDRemotePlayerHUDWidget : public UUserWidget, public IUserObjectListEntry
 {
 	GENERATED_BODY()
 
@@ -21,6 +25,12 @@ public:
 
 	TWeakObjectPtr<AMDPlayerState> OwningPlayerState;
 
+	// Sets owner and shows its current name and stats
+	void SetOwningPlayerState(AMDPlayerState* PlayerState);
+
+	// Shows current name and stats of the owning player
+	void Refresh();
+
 	void SetPlayerName(const FString& Name);
 
 	void SetBestTime(double Time);
@@ -31,13 +41,24 @@ public:
 
 protected:
 
+	virtual void NativeOnInitialized() override;
+
+	virtual void NativeOnListItemObjectSet(UObject* ListItemObject) override;
+
 	UPROPERTY(meta=(BindWidget))
 	UTextBlock* TextBlock_PlayerName;
 
-	UPROPERTY(meta = (BindWidget))
+	UPROPERTY(meta = (BindWidgetOptional))
+	UMDTimeText* TimeText_BestTime;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UMDTimeText* TimeText_LastTime;
+
+	// Older widget blueprints have these instead of the time texts above, they are replaced in NativeOnInitialized
+	UPROPERTY(meta = (BindWidgetOptional))
 	UTextBlock* TextBlock_BestTime;
 
-	UPROPERTY(meta = (BindWidget))
+	UPROPERTY(meta = (BindWidgetOptional))
 	UTextBlock* TextBlock_LastTime;
 
 	UPROPERTY(meta = (BindWidget))
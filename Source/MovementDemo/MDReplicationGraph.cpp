@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDReplicationGraph.h"
+#include "MovementDemo/MDCharacter.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/PlayerController.h"
+#include "Logging/StructuredLog.h"
+#include "ReplicationGraphTypes.h"
+#include "UObject/UObjectIterator.h"
+
+void UMDReplicationGraphNode_RacerFrequencyBuckets::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	if(!Racers || (Params.ReplicationFrameNum % UpdateIntervalFrames) != 0)
+	{
+		return;
+	}
+
+	for(FActorRepListType Racer : *Racers)
+	{
+		bool bIsViewedByConnection = false;
+		double MinDistanceSquared = TNumericLimits<double>::Max();
+		for(const FNetViewer& Viewer : Params.Viewers)
+		{
+			if(Viewer.ViewTarget == Racer || (Viewer.InViewer && Viewer.InViewer == Racer->GetOwner()))
+			{
+				bIsViewedByConnection = true;
+				break;
+			}
+			MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(Viewer.ViewLocation, Racer->GetActorLocation()));
+		}
+
+		uint32 PeriodFrame = BucketPeriodFrames.Num() > 0 ? FarPeriodFrame : 1;
+		if(bIsViewedByConnection)
+		{
+			PeriodFrame = BucketPeriodFrames.Num() > 0 ? BucketPeriodFrames[0] : 1;
+		}
+		else
+		{
+			for(int32 BucketIndex = 0; BucketIndex < BucketMaxDistancesSquared.Num(); ++BucketIndex)
+			{
+				if(MinDistanceSquared <= BucketMaxDistancesSquared[BucketIndex])
+				{
+					PeriodFrame = BucketPeriodFrames[BucketIndex];
+					break;
+				}
+			}
+		}
+
+		// Racer's movement state based rate
+		const uint32 RacerPeriodFrame = FMath::Max(1, FMath::RoundToInt(NetServerMaxTickRate / FMath::Max(Racer->NetUpdateFrequency, 1.0f)));
+		PeriodFrame = FMath::Max(PeriodFrame, RacerPeriodFrame);
+
+		// Racer is still gathered by the grid every frame, this only changes how often it's actually sent to this connection.
+		// Channel must stay open between sends.
+		FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(Racer);
+		ConnectionActorInfo.ReplicationPeriodFrame = static_cast<uint16>(FMath::Min<uint32>(PeriodFrame, MAX_uint16));
+		ConnectionActorInfo.ActorChannelFrameTimeout = static_cast<uint8>(FMath::Min<uint32>(PeriodFrame + 4, MAX_uint8));
+	}
+}
+
+UMDReplicationGraph::UMDReplicationGraph()
+{
+}
+
+void UMDReplicationGraph::ResetGameWorldState()
+{
+	Super::ResetGameWorldState();
+
+	RacerList.Reset();
+}
+
+void UMDReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	for(TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if(!ActorCDO || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		// Skip blueprint compilation leftovers
+		if(Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		// Every class gets its own entry, so subclasses with different settings don't inherit mapping from their parent
+		const EMDClassRepNodeMapping Mapping = ComputeMappingPolicy(Class);
+		ClassRepNodePolicies.Set(Class, Mapping);
+		const bool bSpatialize = Mapping != EMDClassRepNodeMapping::NotRouted && Mapping != EMDClassRepNodeMapping::RelevantAllConnections;
+
+		FClassReplicationInfo ClassInfo;
+		InitClassReplicationInfo(ClassInfo, Class, bSpatialize);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+
+		UE_LOGFMT(LogTemp, Verbose, "Replication Graph: {0} routed as {1}", Class->GetName(), UEnum::GetValueAsString(Mapping));
+	}
+}
+
+void UMDReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	RacerFrequencyBuckets.Sort([](const FMDRacerFrequencyBucket& A, const FMDRacerFrequencyBucket& B) { return A.MaxDistance < B.MaxDistance; });
+
+	RacerBucketMaxDistancesSquared.Reset();
+	RacerBucketPeriodFrames.Reset();
+	for(const auto& Bucket : RacerFrequencyBuckets)
+	{
+		RacerBucketMaxDistancesSquared.Add(FMath::Square(static_cast<double>(Bucket.MaxDistance)));
+		RacerBucketPeriodFrames.Add(GetReplicationPeriodFrameForFrequency(Bucket.UpdateFrequency));
+	}
+}
+
+void UMDReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// PlayerController, its view target and other owner only actors
+	auto* AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+
+	auto* RacerBucketsNode = CreateNewNode<UMDReplicationGraphNode_RacerFrequencyBuckets>();
+	RacerBucketsNode->Racers = &RacerList;
+	RacerBucketsNode->BucketMaxDistancesSquared = RacerBucketMaxDistancesSquared;
+	RacerBucketsNode->BucketPeriodFrames = RacerBucketPeriodFrames;
+	RacerBucketsNode->FarPeriodFrame = GetReplicationPeriodFrameForFrequency(FarRacerUpdateFrequency);
+	RacerBucketsNode->NetServerMaxTickRate = NetDriver ? NetDriver->GetNetServerMaxTickRate() : 30.0f;
+	AddConnectionGraphNode(RacerBucketsNode, RepGraphConnection);
+}
+
+void UMDReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch(GetMappingPolicy(ActorInfo.Class))
+	{
+		case EMDClassRepNodeMapping::RelevantAllConnections:
+		{
+			AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Static:
+		{
+			GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Dynamic:
+		{
+			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Dormancy:
+		{
+			GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Racer:
+		{
+			GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+			RacerList.Add(ActorInfo.Actor);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void UMDReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch(GetMappingPolicy(ActorInfo.Class))
+	{
+		case EMDClassRepNodeMapping::RelevantAllConnections:
+		{
+			AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Static:
+		{
+			GridNode->RemoveActor_Static(ActorInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Dynamic:
+		{
+			GridNode->RemoveActor_Dynamic(ActorInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Spatialize_Dormancy:
+		{
+			GridNode->RemoveActor_Dormancy(ActorInfo);
+			break;
+		}
+		case EMDClassRepNodeMapping::Racer:
+		{
+			GridNode->RemoveActor_Dynamic(ActorInfo);
+			RacerList.RemoveFast(ActorInfo.Actor);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+EMDClassRepNodeMapping UMDReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	// Classes loaded after init use the mapping of their closest parent
+	if(const auto* Mapping = ClassRepNodePolicies.Get(Class))
+	{
+		return *Mapping;
+	}
+
+	const EMDClassRepNodeMapping NewMapping = ComputeMappingPolicy(Class);
+	ClassRepNodePolicies.Set(Class, NewMapping);
+	return NewMapping;
+}
+
+EMDClassRepNodeMapping UMDReplicationGraph::ComputeMappingPolicy(UClass* Class) const
+{
+	EMDClassRepNodeMapping NewMapping = EMDClassRepNodeMapping::Spatialize_Dynamic;
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	if(Class->IsChildOf(AMDCharacter::StaticClass()))
+	{
+		NewMapping = EMDClassRepNodeMapping::Racer;
+	}
+	else if(Class->IsChildOf(APlayerController::StaticClass()) || Class->IsChildOf(ALevelScriptActor::StaticClass()))
+	{
+		// PlayerController is added by AlwaysRelevant_ForConnection node
+		NewMapping = EMDClassRepNodeMapping::NotRouted;
+	}
+	else if(ActorCDO->bAlwaysRelevant)
+	{
+		// GameState and PlayerStates
+		NewMapping = EMDClassRepNodeMapping::RelevantAllConnections;
+	}
+	else if(ActorCDO->bOnlyRelevantToOwner)
+	{
+		NewMapping = EMDClassRepNodeMapping::NotRouted;
+	}
+	else if(ActorCDO->NetDormancy >= DORM_DormantAll || ActorCDO->NetDormancy == DORM_Initial)
+	{
+		NewMapping = EMDClassRepNodeMapping::Spatialize_Dormancy;
+	}
+	else if(!ActorCDO->GetRootComponent() || ActorCDO->GetRootComponent()->Mobility == EComponentMobility::Static)
+	{
+		NewMapping = EMDClassRepNodeMapping::Spatialize_Static;
+	}
+
+	return NewMapping;
+}
+
+void UMDReplicationGraph::InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+	if(bSpatialize)
+	{
+		Info.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+	}
+
+	Info.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+}
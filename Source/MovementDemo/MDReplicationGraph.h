@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MDReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+UENUM()
+enum class EMDClassRepNodeMapping : uint8
+{
+	NotRouted, // Doesn't map to any node. Used for special case actors that are handled by special case nodes (PlayerController, owner only actors).
+	RelevantAllConnections, // Routes to an AlwaysRelevantNode (GameState, PlayerStates).
+	Spatialize_Static, // Routes to GridNode, actor doesn't move.
+	Spatialize_Dynamic, // Routes to GridNode, actor is updated every frame.
+	Spatialize_Dormancy, // Routes to GridNode, actor is treated as static while dormant and dynamic while awake.
+	Racer, // Routes to GridNode as dynamic, and to racer frequency buckets of every connection.
+};
+
+// Racers closer than MaxDistance to the viewer are replicated at UpdateFrequency.
+USTRUCT()
+struct FMDRacerFrequencyBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, meta = (ForceUnits = "cm"))
+	float MaxDistance = 0.0f;
+
+	UPROPERTY(EditAnywhere, meta = (ForceUnits = "Hz"))
+	float UpdateFrequency = 30.0f;
+};
+
+/**
+ * Per connection node that doesn't gather anything itself. Racers are gathered by the grid node, this node just lowers their replication
+ * period for this connection based on distance to the viewer. Nearby racers stay at full rate, far away ones are sent less often.
+ * Racer's own NetUpdateFrequency is a lower limit for the period, so idle or rooted racers stay slow even when close.
+ */
+UCLASS()
+class MOVEMENTDEMO_API UMDReplicationGraphNode_RacerFrequencyBuckets : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override {}
+
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+
+	virtual void NotifyResetAllNetworkActors() override {}
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	// Owned by the graph, shared by all connections
+	const FActorRepListRefView* Racers = nullptr;
+
+	// Squared MaxDistance of each bucket, sorted ascending. Copied from UMDReplicationGraph.
+	TArray<double> BucketMaxDistancesSquared;
+
+	// Period frames of each bucket, same order as BucketMaxDistancesSquared
+	TArray<uint32> BucketPeriodFrames;
+
+	// Used for racers beyond last bucket
+	uint32 FarPeriodFrame = 1;
+
+	// Buckets are only reassigned every this many frames, racers don't move that fast
+	uint32 UpdateIntervalFrames = 4;
+
+	// Used to turn racer's own NetUpdateFrequency (see UMDCharacterNetUpdatePolicy) into period frames
+	float NetServerMaxTickRate = 30.0f;
+};
+
+/**
+ * Replication Graph for the race. Enabled with ReplicationDriverClassName in DefaultEngine.ini.
+ * 1. Characters go to a 2D spatial grid, so each connection only considers racers that are near it.
+ * 2. In addition, every connection has UMDReplicationGraphNode_RacerFrequencyBuckets which lowers update rate of racers far from its viewer.
+ * 3. GameState and PlayerStates (scoreboard, standings) are always relevant. PlayerController and owner only data are handled by the per connection AlwaysRelevant node.
+ *    Checkpoint tracker is not replicated, owning client gets checkpoint changes trough a client RPC.
+ * 4. Checkpoints are initially dormant and routed to the grid as dormant actors, so they cost nothing per frame.
+ * Class routing is decided once in InitGlobalActorClassSettings, see EMDClassRepNodeMapping.
+ */
+UCLASS(Transient, Config = Engine)
+class MOVEMENTDEMO_API UMDReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	UMDReplicationGraph();
+
+	virtual void ResetGameWorldState() override;
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	UPROPERTY(Config)
+	float GridCellSize = 10000.0f;
+
+	// Essentially "Min X" for replication. This is just an initial value, the grid will grow if needed.
+	UPROPERTY(Config)
+	float SpatialBiasX = -150000.0f;
+
+	// Essentially "Min Y" for replication. This is just an initial value, the grid will grow if needed.
+	UPROPERTY(Config)
+	float SpatialBiasY = -200000.0f;
+
+	UPROPERTY(Config)
+	TArray<FMDRacerFrequencyBucket> RacerFrequencyBuckets;
+
+	// Update frequency for racers further away than the last bucket, but still inside cull distance
+	UPROPERTY(Config)
+	float FarRacerUpdateFrequency = 5.0f;
+
+	// Precomputed from RacerFrequencyBuckets in InitGlobalGraphNodes, handed to every connection's bucket node
+	TArray<double> RacerBucketMaxDistancesSquared;
+
+	TArray<uint32> RacerBucketPeriodFrames;
+
+protected:
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_GridSpatialization2D> GridNode;
+
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
+
+	// All racers, shared with the per connection frequency bucket nodes
+	FActorRepListRefView RacerList;
+
+	TClassMap<EMDClassRepNodeMapping> ClassRepNodePolicies;
+
+	EMDClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	EMDClassRepNodeMapping ComputeMappingPolicy(UClass* Class) const;
+
+	void InitClassReplicationInfo(FClassReplicationInfo& Info, UClass* Class, bool bSpatialize) const;
+};
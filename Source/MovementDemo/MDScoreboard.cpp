@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDScoreboard.h"
+#include "MovementDemo/MDGameStateBase.h"
+
+int32 FMDScoreboardEntry::QuantizeTime(double Time)
+{
+	return Time < 0.0 ? INDEX_NONE : FMath::RoundToInt32(Time * 1000.0);
+}
+
+double FMDScoreboardEntry::DequantizeTime(int32 TimeMs)
+{
+	return TimeMs < 0 ? -1.0 : TimeMs / 1000.0;
+}
+
+void FMDScoreboardEntry::PreReplicatedRemove(const FMDScoreboard& InArraySerializer)
+{
+	// PlayerState is removed by its own replication, nothing to do here
+}
+
+void FMDScoreboardEntry::PostReplicatedAdd(const FMDScoreboard& InArraySerializer)
+{
+	if (IsValid(InArraySerializer.OwningGameState))
+	{
+		InArraySerializer.OwningGameState->OnScoreboardEntryReplicated(*this);
+	}
+}
+
+void FMDScoreboardEntry::PostReplicatedChange(const FMDScoreboard& InArraySerializer)
+{
+	if (IsValid(InArraySerializer.OwningGameState))
+	{
+		InArraySerializer.OwningGameState->OnScoreboardEntryReplicated(*this);
+	}
+}
+
+const FMDScoreboardEntry* FMDScoreboard::FindEntry(int32 PlayerId) const
+{
+	const int32* Index = EntryIndexByPlayerId.Find(PlayerId);
+	return Index ? &Entries[*Index] : nullptr;
+}
+
+FMDScoreboardEntry& FMDScoreboard::FindOrAddEntry(int32 PlayerId)
+{
+	if (const int32* Index = EntryIndexByPlayerId.Find(PlayerId))
+	{
+		return Entries[*Index];
+	}
+
+	EntryIndexByPlayerId.Add(PlayerId, Entries.Num());
+	FMDScoreboardEntry& NewEntry = Entries.AddDefaulted_GetRef();
+	NewEntry.PlayerId = PlayerId;
+	MarkItemDirty(NewEntry);
+	return NewEntry;
+}
+
+void FMDScoreboard::RemoveEntry(int32 PlayerId)
+{
+	int32 Index;
+	if (!EntryIndexByPlayerId.RemoveAndCopyValue(PlayerId, Index))
+	{
+		return;
+	}
+
+	Entries.RemoveAtSwap(Index);
+	// Last entry was moved into the removed one's place
+	if (Entries.IsValidIndex(Index))
+	{
+		EntryIndexByPlayerId.Add(Entries[Index].PlayerId, Index);
+	}
+	MarkArrayDirty();
+}
+
+void FMDScoreboard::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	// Removes swap entries around, rebuilding once per delta is simpler than tracking every move
+	EntryIndexByPlayerId.Reset();
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		EntryIndexByPlayerId.Add(Entries[Index].PlayerId, Index);
+	}
+}
+
+void FMDScoreboard::ClearReachedGoalFlags()
+{
+	for (auto& Entry : Entries)
+	{
+		Entry.bHasReachedGoal = false;
+	}
+}
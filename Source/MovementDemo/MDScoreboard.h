@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "MDScoreboard.generated.h"
+
+class AMDGameStateBase;
+struct FMDScoreboard;
+
+/**
+ * Replicated stats of a single player. Times are quantized to milliseconds.
+ */
+USTRUCT()
+struct MOVEMENTDEMO_API FMDScoreboardEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 PlayerId = INDEX_NONE;
+
+	// INDEX_NONE if never completed
+	UPROPERTY()
+	int32 BestTimeMs = INDEX_NONE;
+
+	// INDEX_NONE if never completed
+	UPROPERTY()
+	int32 LastTimeMs = INDEX_NONE;
+
+	UPROPERTY()
+	uint16 Wins = 0;
+
+	UPROPERTY()
+	bool bHasReachedGoal = false;
+
+	static int32 QuantizeTime(double Time);
+
+	static double DequantizeTime(int32 TimeMs);
+
+	void PreReplicatedRemove(const FMDScoreboard& InArraySerializer);
+
+	void PostReplicatedAdd(const FMDScoreboard& InArraySerializer);
+
+	void PostReplicatedChange(const FMDScoreboard& InArraySerializer);
+};
+
+/**
+ * Scoreboard lives in MDGameStateBase and replicates stats of all players as a delta serialized fast array.
+ * Changing stats of one player only sends that entry, instead of forcing net update on the player's PlayerState.
+ * See MDPlayerState.h for how the entries are applied on clients.
+ */
+USTRUCT()
+struct MOVEMENTDEMO_API FMDScoreboard : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FMDScoreboardEntry> Entries;
+
+	UPROPERTY(NotReplicated)
+	TObjectPtr<AMDGameStateBase> OwningGameState = nullptr;
+
+	// Index of each PlayerId in Entries. Kept up to date on server, rebuilt after each received delta on clients.
+	TMap<int32, int32> EntryIndexByPlayerId;
+
+	const FMDScoreboardEntry* FindEntry(int32 PlayerId) const;
+
+	// Server only. Caller needs to call MarkItemDirty after changing the entry.
+	FMDScoreboardEntry& FindOrAddEntry(int32 PlayerId);
+
+	// Server only.
+	void RemoveEntry(int32 PlayerId);
+
+	// Server only. Does not mark anything dirty, clients clear their flags on match reset event.
+	void ClearReachedGoalFlags();
+
+	// Called by fast array once per received delta, after all adds, changes and removes
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FMDScoreboardEntry, FMDScoreboard>(Entries, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FMDScoreboard> : public TStructOpsTypeTraitsBase2<FMDScoreboard>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDSignificanceSubsystem.h"
+#include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDGameStateBase.h"
+#include "MovementDemo/MDSkeletalMeshComponent.h"
+#include "EngineUtils.h"
+#include "IAnimationBudgetAllocator.h"
+#include "SignificanceManager.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Logging/StructuredLog.h"
+
+namespace MDSignificance
+{
+	static const FName RacerTag = "MDRacer";
+
+	static FAutoConsoleCommandWithWorldAndArgs StatsCmd(
+		TEXT("MD.Significance"),
+		TEXT("Prints how many racers are on each significance level."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (const auto* Subsystem = World ? World->GetSubsystem<UMDSignificanceSubsystem>() : nullptr)
+			{
+				Subsystem->DumpStats();
+			}
+		}));
+}
+
+UMDSignificanceSubsystem::UMDSignificanceSubsystem()
+{
+	Medium.NetworkSmoothingMode = ENetworkSmoothingMode::Linear;
+	Medium.AnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	Medium.AnimTickInterval = 1.0f / 30.0f;
+
+	Low.NetworkSmoothingMode = ENetworkSmoothingMode::Linear;
+	Low.AnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+	Low.AnimTickInterval = 1.0f / 10.0f;
+	Low.MovementTickInterval = 1.0f / 15.0f;
+	Low.bShowNamePlate = false;
+}
+
+bool UMDSignificanceSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	const UWorld* World = CastChecked<UWorld>(Outer);
+	return World->GetNetMode() != NM_DedicatedServer; // nothing is rendered on dedicated servers
+}
+
+void UMDSignificanceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (auto* Allocator = IAnimationBudgetAllocator::Get(&InWorld))
+	{
+		Allocator->SetParameters(AnimationBudget);
+		Allocator->SetEnabled(bUseAnimationBudget);
+	}
+}
+
+bool UMDSignificanceSubsystem::IsAnimationBudgetEnabled() const
+{
+	const auto* Allocator = IAnimationBudgetAllocator::Get(GetWorld());
+	return Allocator && Allocator->GetEnabled();
+}
+
+bool UMDSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMDSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	auto* SignificanceManager = GetSignificanceManager();
+	if (!SignificanceManager)
+	{
+		return;
+	}
+
+	const UWorld* World = GetWorld();
+	const auto* GS = World->GetGameState<AMDGameStateBase>();
+	CurrentGameState = GS;
+
+	Viewpoints.Reset();
+	LocalRacePosition = INDEX_NONE;
+	for (auto It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PC = It->Get();
+		if (!PC || !PC->IsLocalController())
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		Viewpoints.Emplace(ViewRotation, ViewLocation);
+
+		if (GS && PC->PlayerState && LocalRacePosition == INDEX_NONE)
+		{
+			LocalRacePosition = GS->GetRacePosition(PC->PlayerState->GetPlayerId());
+		}
+	}
+
+	SignificanceManager->Update(Viewpoints);
+	CurrentGameState = nullptr;
+}
+
+TStatId UMDSignificanceSubsystem::GetStatId() const
+{
+	return UObject::GetStatID();
+}
+
+USignificanceManager* UMDSignificanceSubsystem::GetSignificanceManager() const
+{
+	return USignificanceManager::Get(GetWorld());
+}
+
+void UMDSignificanceSubsystem::RegisterRacer(AMDCharacter& Racer)
+{
+	auto* SignificanceManager = GetSignificanceManager();
+	if (!ensure(SignificanceManager))
+	{
+		return;
+	}
+
+	SignificanceManager->RegisterObject(&Racer, MDSignificance::RacerTag,
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+		{
+			return CalculateSignificance(*CastChecked<AMDCharacter>(ObjectInfo->GetObject()), Viewpoint);
+		},
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[this](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float NewSignificance, bool bFinal)
+		{
+			OnSignificanceChanged(*CastChecked<AMDCharacter>(ObjectInfo->GetObject()), NewSignificance);
+		});
+}
+
+void UMDSignificanceSubsystem::UnregisterRacer(AMDCharacter& Racer)
+{
+	if (auto* SignificanceManager = GetSignificanceManager())
+	{
+		SignificanceManager->UnregisterObject(&Racer);
+	}
+}
+
+const FMDSignificanceSettings& UMDSignificanceSubsystem::GetSettings(EMDSignificanceLevel Level) const
+{
+	switch (Level)
+	{
+	case EMDSignificanceLevel::Medium:	return Medium;
+	case EMDSignificanceLevel::Low:		return Low;
+	default:							return High;
+	}
+}
+
+EMDSignificanceLevel UMDSignificanceSubsystem::GetLevelForSignificance(float Significance) const
+{
+	if (Significance >= HighThreshold)
+	{
+		return EMDSignificanceLevel::High;
+	}
+	return Significance >= MediumThreshold ? EMDSignificanceLevel::Medium : EMDSignificanceLevel::Low;
+}
+
+float UMDSignificanceSubsystem::CalculateSignificance(const AMDCharacter& Racer, const FTransform& Viewpoint) const
+{
+	if (Racer.IsLocallyControlled())
+	{
+		return 1.0f;
+	}
+
+	const double Distance = FVector::Dist(Viewpoint.GetLocation(), Racer.GetActorLocation());
+	float Significance = 1.0f - FMath::Clamp(static_cast<float>(Distance / MaxDistance), 0.0f, 1.0f);
+
+	if (!Racer.WasRecentlyRendered(0.25f))
+	{
+		Significance *= OffScreenScale;
+	}
+
+	// Racers we are fighting with for position are likely to come into view soon
+	if (LocalRacePosition != INDEX_NONE && RaceProximityPositions > 0)
+	{
+		const auto* PS = Racer.GetPlayerState();
+		const int32 RacePosition = CurrentGameState && PS ? CurrentGameState->GetRacePosition(PS->GetPlayerId()) : INDEX_NONE;
+		const int32 Gap = RacePosition != INDEX_NONE ? FMath::Max(FMath::Abs(RacePosition - LocalRacePosition), 1) : MAX_int32;
+		if (Gap <= RaceProximityPositions)
+		{
+			Significance += RaceProximityBonus * (1.0f - static_cast<float>(Gap - 1) / RaceProximityPositions);
+		}
+	}
+
+	return FMath::Min(Significance, 1.0f);
+}
+
+void UMDSignificanceSubsystem::OnSignificanceChanged(AMDCharacter& Racer, float NewSignificance)
+{
+	const bool bAnimationBudgetEnabled = IsAnimationBudgetEnabled();
+	if (bAnimationBudgetEnabled)
+	{
+		if (auto* Mesh = Cast<UMDSkeletalMeshComponent>(Racer.GetMesh()))
+		{
+			// Own pawn always animates at full rate
+			const bool bNeverSkip = Racer.IsLocallyControlled();
+			IAnimationBudgetAllocator::Get(GetWorld())->SetComponentSignificance(Mesh, NewSignificance, bNeverSkip);
+		}
+	}
+
+	const EMDSignificanceLevel NewLevel = GetLevelForSignificance(NewSignificance);
+	if (NewLevel != Racer.GetSignificanceLevel())
+	{
+		Racer.ApplySignificance(NewLevel, GetSettings(NewLevel), !bAnimationBudgetEnabled);
+	}
+}
+
+void UMDSignificanceSubsystem::DumpStats() const
+{
+	int32 NumRacersOnLevel[static_cast<int32>(EMDSignificanceLevel::Count)] = {};
+	for (const AMDCharacter* Racer : TActorRange<AMDCharacter>(GetWorld()))
+	{
+		++NumRacersOnLevel[static_cast<int32>(Racer->GetSignificanceLevel())];
+	}
+
+	UE_LOGFMT(LogTemp, Log, "Racer significance: High {High}, Medium {Medium}, Low {Low}.",
+		NumRacersOnLevel[static_cast<int32>(EMDSignificanceLevel::High)],
+		NumRacersOnLevel[static_cast<int32>(EMDSignificanceLevel::Medium)],
+		NumRacersOnLevel[static_cast<int32>(EMDSignificanceLevel::Low)]);
+}
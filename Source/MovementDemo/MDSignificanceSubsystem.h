@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AnimationBudgetAllocatorParameters.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MDSignificanceSubsystem.generated.h"
+
+class AMDCharacter;
+class AMDGameStateBase;
+class USignificanceManager;
+
+UENUM()
+enum class EMDSignificanceLevel : uint8
+{
+	High,
+	Medium,
+	Low,
+	Count UMETA(Hidden),
+};
+
+// How faithfully a remote racer is simulated and presented at a significance level
+USTRUCT()
+struct FMDSignificanceSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Config)
+	ENetworkSmoothingMode NetworkSmoothingMode = ENetworkSmoothingMode::Exponential;
+
+	// Not used when animation budget is enabled
+	UPROPERTY(EditAnywhere, Config)
+	EVisibilityBasedAnimTickOption AnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+	// 0 ticks every frame. Not used when animation budget is enabled, allocator decides tick rate then.
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "s"))
+	float AnimTickInterval = 0.0f;
+
+	// Simulated proxies only, 0 ticks every frame
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", UIMin = "0", ForceUnits = "s"))
+	float MovementTickInterval = 0.0f;
+
+	UPROPERTY(EditAnywhere, Config)
+	bool bShowNamePlate = true;
+};
+
+/**
+ * Client side WorldSubsystem that scales remote racer fidelity with how much they matter to local player. Not created on dedicated servers.
+ * 1. MDCharacters register to engine's SignificanceManager trough this subsystem on BeginPlay.
+ * 2. Every frame local player view points are passed to SignificanceManager, which scores each racer:
+ *    closer is better, racers not rendered recently are scaled down, and racers close to local player in race standings get a bonus.
+ * 3. Score is mapped to High/Medium/Low, and the settings of the level (DefaultGame.ini) are applied when the level changes.
+ * 4. If bUseAnimationBudget is set, character meshes (UMDSkeletalMeshComponent) run under the animation budget allocator with AnimationBudget parameters.
+ *    Allocator gets the same significance and decides anim tick rate and interpolation itself. MD.AnimBudget reports what was spent.
+ * Locally controlled pawn is always High. MD.Significance prints how many racers are on each level.
+ */
+UCLASS(Config = Game)
+class MOVEMENTDEMO_API UMDSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UMDSignificanceSubsystem();
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	void RegisterRacer(AMDCharacter& Racer);
+
+	void UnregisterRacer(AMDCharacter& Racer);
+
+	const FMDSignificanceSettings& GetSettings(EMDSignificanceLevel Level) const;
+
+	EMDSignificanceLevel GetLevelForSignificance(float Significance) const;
+
+	void DumpStats() const;
+
+	// Racers further than this from every view point get no distance score
+	UPROPERTY(EditAnywhere, Config, meta = (ForceUnits = "cm"))
+	float MaxDistance = 6000.0f;
+
+	// Multiplier for racers that were not rendered recently
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", ClampMax = "1"))
+	float OffScreenScale = 0.25f;
+
+	// Racers within this many positions of local player in race standings get RaceProximityBonus, scaled down by the gap
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0"))
+	int32 RaceProximityPositions = 2;
+
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", ClampMax = "1"))
+	float RaceProximityBonus = 0.3f;
+
+	// Significance at or above this is High
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", ClampMax = "1"))
+	float HighThreshold = 0.6f;
+
+	// Significance at or above this is Medium, below is Low
+	UPROPERTY(EditAnywhere, Config, meta = (ClampMin = "0", ClampMax = "1"))
+	float MediumThreshold = 0.25f;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDSignificanceSettings High;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDSignificanceSettings Medium;
+
+	UPROPERTY(EditAnywhere, Config)
+	FMDSignificanceSettings Low;
+
+	UPROPERTY(EditAnywhere, Config)
+	bool bUseAnimationBudget = true;
+
+	// BudgetInMs is game thread time for all character meshes per frame
+	UPROPERTY(EditAnywhere, Config)
+	FAnimationBudgetAllocatorParameters AnimationBudget;
+
+	bool IsAnimationBudgetEnabled() const;
+
+protected:
+
+	// Race position of the local player this frame, INDEX_NONE if not racing
+	int32 LocalRacePosition = INDEX_NONE;
+
+	// Only set while the significance manager updates in Tick, saves looking it up for every racer
+	const AMDGameStateBase* CurrentGameState = nullptr;
+
+	TArray<FTransform> Viewpoints;
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	USignificanceManager* GetSignificanceManager() const;
+
+	float CalculateSignificance(const AMDCharacter& Racer, const FTransform& Viewpoint) const;
+
+	void OnSignificanceChanged(AMDCharacter& Racer, float NewSignificance);
+};
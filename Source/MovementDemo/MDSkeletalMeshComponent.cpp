@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDSkeletalMeshComponent.h"
+#include "MovementDemo/MDCharacter.h"
+#include "MovementDemo/MDPlayerAnimInstance.h"
+#include "MovementDemo/MDSignificanceSubsystem.h"
+#include "EngineUtils.h"
+#include "IAnimationBudgetAllocator.h"
+#include "Logging/StructuredLog.h"
+
+namespace MDAnimBudgetStats
+{
+	static double TotalTickTimeMs = 0.0;
+
+	static int64 NumTicks = 0;
+
+	static uint64 StartFrame = 0;
+
+	static FAutoConsoleCommandWithWorldAndArgs DumpCmd(
+		TEXT("MD.AnimBudget"),
+		TEXT("Prints animation budget and how much of it character meshes spent on game thread since the last reset."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UMDSkeletalMeshComponent::DumpStats(World);
+		}));
+
+	static FAutoConsoleCommand ResetCmd(
+		TEXT("MD.AnimBudget.Reset"),
+		TEXT("Resets animation budget stats."),
+		FConsoleCommandDelegate::CreateStatic(&UMDSkeletalMeshComponent::ResetStats));
+}
+
+void UMDSkeletalMeshComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	MDAnimBudgetStats::TotalTickTimeMs += (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	++MDAnimBudgetStats::NumTicks;
+}
+
+void UMDSkeletalMeshComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	OnReduceWork().BindUObject(this, &ThisClass::OnReduceWorkChanged);
+}
+
+void UMDSkeletalMeshComponent::OnReduceWorkChanged(USkeletalMeshComponentBudgeted* Component, bool bReduce)
+{
+	if(auto* AnimInstance = Cast<UMDPlayerAnimInstance>(GetAnimInstance()))
+	{
+		AnimInstance->SetReducedWork(bReduce);
+	}
+}
+
+void UMDSkeletalMeshComponent::DumpStats(UWorld* World)
+{
+	const uint64 NumFrames = FMath::Max<uint64>(GFrameCounter - MDAnimBudgetStats::StartFrame, 1);
+
+	int32 NumMeshes = 0;
+	if(World)
+	{
+		for(const AMDCharacter* Character : TActorRange<AMDCharacter>(World))
+		{
+			NumMeshes += Character->GetMesh()->IsA<UMDSkeletalMeshComponent>() ? 1 : 0;
+		}
+	}
+
+	const auto* Allocator = World ? IAnimationBudgetAllocator::Get(World) : nullptr;
+	const auto* SignificanceSubsystem = World ? World->GetSubsystem<UMDSignificanceSubsystem>() : nullptr;
+	const bool bEnabled = Allocator && Allocator->GetEnabled();
+	const float BudgetMs = SignificanceSubsystem ? SignificanceSubsystem->AnimationBudget.BudgetInMs : 0.0f;
+
+	UE_LOGFMT(LogTemp, Log, "Animation budget {Enabled}, {Budget} ms. Spent {Spent} ms per frame on game thread over {Frames} frames, {Ticks} of {Meshes} character meshes ticked per frame.",
+		bEnabled ? TEXT("enabled") : TEXT("disabled"), BudgetMs, MDAnimBudgetStats::TotalTickTimeMs / NumFrames, NumFrames,
+		static_cast<double>(MDAnimBudgetStats::NumTicks) / NumFrames, NumMeshes);
+}
+
+void UMDSkeletalMeshComponent::ResetStats()
+{
+	MDAnimBudgetStats::TotalTickTimeMs = 0.0;
+	MDAnimBudgetStats::NumTicks = 0;
+	MDAnimBudgetStats::StartFrame = GFrameCounter;
+}
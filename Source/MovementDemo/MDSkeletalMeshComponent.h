@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "MDSkeletalMeshComponent.generated.h"
+
+/**
+ * Character mesh that runs under the animation budget allocator. Budget is configured in UMDSignificanceSubsystem, which also feeds significance to the allocator,
+ * so significance is not auto calculated.
+ * When allocator asks to reduce work, UMDPlayerAnimInstance::bReducedWork is set, so the AnimBP can skip Control Rig.
+ * Game thread tick time is summed over all character meshes, MD.AnimBudget prints it next to the budget.
+ */
+UCLASS(ClassGroup=(Rendering), meta=(BlueprintSpawnableComponent))
+class MOVEMENTDEMO_API UMDSkeletalMeshComponent : public USkeletalMeshComponentBudgeted
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	static void DumpStats(UWorld* World);
+
+	static void ResetStats();
+
+protected:
+
+	virtual void OnRegister() override;
+
+	void OnReduceWorkChanged(USkeletalMeshComponentBudgeted* Component, bool bReduce);
+};
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDSpawnSlotAllocator.h"
+#include "EngineUtils.h"
+#include "Engine/PlayerStartPIE.h"
+#include "GameFramework/PlayerStart.h"
+#include "Logging/StructuredLog.h"
+
+void FMDSpawnSlotAllocator::Build(UWorld& World, const APawn* PawnToFit)
+{
+	Slots.Reset();
+	FreeUnoccupiedSlots.Reset();
+	FreeOccupiedSlots.Reset();
+	AssignedSlots.Reset();
+	PIEPlayerStart.Reset();
+	NumUnoccupiedSlots = 0;
+	NextSharedSlot = 0;
+
+	TArray<APlayerStart*> OccupiedStartPoints;
+
+	for(auto* PlayerStart : TActorRange<APlayerStart>(&World))
+	{
+		if (PlayerStart->IsA<APlayerStartPIE>())
+		{
+			// Always prefer the first "Play from Here" PlayerStart, if we find one while in PIE mode
+			PIEPlayerStart = PlayerStart;
+			break;
+		}
+
+		FVector StartLocation = PlayerStart->GetActorLocation();
+		FRotator StartRotation = PlayerStart->GetActorRotation();
+
+		if (!PawnToFit || !World.EncroachingBlockingGeometry(PawnToFit, StartLocation, StartRotation))
+		{
+			Slots.Add(PlayerStart);
+		}
+		else if (World.FindTeleportSpot(PawnToFit, StartLocation, StartRotation))
+		{
+			OccupiedStartPoints.Add(PlayerStart);
+		}
+	}
+
+	NumUnoccupiedSlots = Slots.Num();
+	Slots.Append(OccupiedStartPoints);
+
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		if (Index < NumUnoccupiedSlots)
+		{
+			FreeUnoccupiedSlots.Add(Index);
+		}
+		else
+		{
+			FreeOccupiedSlots.Add(Index);
+		}
+	}
+
+	bIsBuilt = true;
+
+	UE_LOGFMT(LogTemp, Log, "Spawn slots built. Unoccupied: {0}, Occupied: {1}", NumUnoccupiedSlots, Slots.Num() - NumUnoccupiedSlots);
+}
+
+APlayerStart* FMDSpawnSlotAllocator::GetOrAssignSlot(const AController* Controller)
+{
+	if (PIEPlayerStart.IsValid())
+	{
+		return PIEPlayerStart.Get();
+	}
+
+	if (Slots.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	if (const int32* SlotIndex = AssignedSlots.Find(Controller))
+	{
+		return Slots[*SlotIndex].Get();
+	}
+
+	int32 NewSlotIndex = INDEX_NONE;
+	TArray<int32>& FreeSlots = FreeUnoccupiedSlots.Num() > 0 ? FreeUnoccupiedSlots : FreeOccupiedSlots;
+	if (FreeSlots.Num() > 0)
+	{
+		const int32 FreeIndex = FMath::RandRange(0, FreeSlots.Num() - 1);
+		NewSlotIndex = FreeSlots[FreeIndex];
+		FreeSlots.RemoveAtSwap(FreeIndex, 1, false);
+		AssignedSlots.Add(Controller, NewSlotIndex);
+	}
+	else
+	{
+		// More players than slots, spread the rest evenly. These are not assigned, so they can't be released either.
+		UE_LOGFMT(LogTemp, Warning, "Out of spawn slots, {0} players need to share.", AssignedSlots.Num() + 1);
+		NewSlotIndex = NextSharedSlot;
+		NextSharedSlot = (NextSharedSlot + 1) % Slots.Num();
+	}
+
+	return Slots[NewSlotIndex].Get();
+}
+
+void FMDSpawnSlotAllocator::ReleaseSlot(const AController* Controller)
+{
+	int32 SlotIndex = INDEX_NONE;
+	if (AssignedSlots.RemoveAndCopyValue(Controller, SlotIndex))
+	{
+		if (SlotIndex < NumUnoccupiedSlots)
+		{
+			FreeUnoccupiedSlots.Add(SlotIndex);
+		}
+		else
+		{
+			FreeOccupiedSlots.Add(SlotIndex);
+		}
+	}
+}
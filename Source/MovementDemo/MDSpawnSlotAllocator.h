@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AController;
+class APawn;
+class APlayerStart;
+
+/**
+ * Spawn slots for MDGameModeBase.
+ * PlayerStarts are validated against blocking geometry once, when the slots are built. After that every controller gets its own slot,
+ * which it keeps until it is released on logout. Choosing a start spot is then a map lookup instead of checking every start against every pawn.
+ * Players don't collide with each other, so we only need to make sure two players never share a slot.
+ */
+struct MOVEMENTDEMO_API FMDSpawnSlotAllocator
+{
+public:
+
+	// Collects and validates all PlayerStarts in the world. PawnToFit is used for collision checks.
+	void Build(UWorld& World, const APawn* PawnToFit);
+
+	bool IsBuilt() const { return bIsBuilt; }
+
+	// Returns the slot of the controller, assigning a random free one if it has none yet.
+	// If all slots are taken, slots are shared. Returns nullptr only if there are no valid PlayerStarts.
+	APlayerStart* GetOrAssignSlot(const AController* Controller);
+
+	void ReleaseSlot(const AController* Controller);
+
+	int32 GetNumSlots() const { return Slots.Num(); }
+
+protected:
+
+	// Valid PlayerStarts. Starts that need FindTeleportSpot adjustment are after the unoccupied ones.
+	TArray<TWeakObjectPtr<APlayerStart>> Slots;
+
+	// Number of slots at the start of Slots that don't need any adjustment
+	int32 NumUnoccupiedSlots = 0;
+
+	// Indices to Slots
+	TArray<int32> FreeUnoccupiedSlots;
+
+	TArray<int32> FreeOccupiedSlots;
+
+	TMap<TWeakObjectPtr<const AController>, int32> AssignedSlots;
+
+	// "Play from Here" start in PIE, everyone spawns there if set
+	TWeakObjectPtr<APlayerStart> PIEPlayerStart;
+
+	int32 NextSharedSlot = 0;
+
+	bool bIsBuilt = false;
+};
@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDTimeText.h"
+#include "Blueprint/UserWidget.h"
+#include "Blueprint/WidgetTree.h"
+#include "Components/PanelWidget.h"
+#include "Components/TextBlock.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Fonts/FontCache.h"
+#include "Fonts/FontMeasure.h"
+#include "Rendering/DrawElements.h"
+#include "Styling/CoreStyle.h"
+#include "Widgets/SLeafWidget.h"
+
+#define LOCTEXT_NAMESPACE "MovementDemo"
+
+namespace MDTimeText
+{
+	// Widest time we expect to show, used for desired size
+	static const FString WidestTime = TEXT("0000.000");
+
+	// Room for any int64 milliseconds value
+	static constexpr int32 MaxChars = 24;
+
+	// Every character a time can have. Each is shaped once and painted from the cache.
+	static const TCHAR GlyphChars[] = TEXT("0123456789.");
+	static constexpr int32 NumGlyphs = UE_ARRAY_COUNT(GlyphChars) - 1;
+
+	static int32 GetGlyphIndex(TCHAR Char)
+	{
+		return Char == TEXT('.') ? NumGlyphs - 1 : Char - TEXT('0');
+	}
+
+	// Writes milliseconds as seconds with three decimals. Out must have enough slack reserved, so nothing gets allocated.
+	static void FormatMilliseconds(int64 Milliseconds, FString& Out)
+	{
+		TCHAR Reversed[MaxChars];
+		int32 Num = 0;
+
+		int64 Remaining = Milliseconds;
+		for(int32 Digit = 0; Digit < 3; ++Digit)
+		{
+			Reversed[Num++] = TEXT('0') + static_cast<TCHAR>(Remaining % 10);
+			Remaining /= 10;
+		}
+		Reversed[Num++] = TEXT('.');
+		do
+		{
+			Reversed[Num++] = TEXT('0') + static_cast<TCHAR>(Remaining % 10);
+			Remaining /= 10;
+		}
+		while(Remaining > 0);
+
+		Out.Reset(MaxChars);
+		while(Num > 0)
+		{
+			Out.AppendChar(Reversed[--Num]);
+		}
+	}
+
+	static int64 ToMilliseconds(double Seconds, bool bEmptyWhenZero)
+	{
+		const int64 Milliseconds = FMath::RoundToInt64(Seconds * 1000.0);
+		return Milliseconds < 0 || (bEmptyWhenZero && Milliseconds == 0) ? INDEX_NONE : Milliseconds;
+	}
+}
+
+/**
+ * Leaf widget that paints preformatted time string. See UMDTimeText.
+ * Each character is painted from a glyph sequence shaped once per font and scale, so painting doesn't copy the string or shape text.
+ */
+class SMDTimeText : public SLeafWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(SMDTimeText)
+		{}
+		SLATE_ARGUMENT(FSlateFontInfo, Font)
+		SLATE_ARGUMENT(FSlateColor, ColorAndOpacity)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs)
+	{
+		Font = InArgs._Font;
+		ColorAndOpacity = InArgs._ColorAndOpacity;
+		DisplayedText.Reset(MDTimeText::MaxChars);
+	}
+
+	void SetMilliseconds(int64 NewMilliseconds)
+	{
+		if(NewMilliseconds == DisplayedMilliseconds)
+		{
+			return;
+		}
+
+		DisplayedMilliseconds = NewMilliseconds;
+		if(DisplayedMilliseconds == INDEX_NONE)
+		{
+			DisplayedText.Reset(MDTimeText::MaxChars);
+		}
+		else
+		{
+			MDTimeText::FormatMilliseconds(DisplayedMilliseconds, DisplayedText);
+		}
+
+		// Desired size doesn't depend on the value, only repaint
+		Invalidate(EInvalidateWidgetReason::Paint);
+	}
+
+	void SetFont(const FSlateFontInfo& NewFont)
+	{
+		Font = NewFont;
+		ShapedFontScale = 0.0f;
+		Invalidate(EInvalidateWidgetReason::Layout);
+	}
+
+	void SetColorAndOpacity(const FSlateColor& NewColorAndOpacity)
+	{
+		ColorAndOpacity = NewColorAndOpacity;
+		Invalidate(EInvalidateWidgetReason::Paint);
+	}
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override
+	{
+		if(DisplayedText.IsEmpty())
+		{
+			return LayerId;
+		}
+
+		const float Scale = AllottedGeometry.Scale;
+		if(Scale != ShapedFontScale)
+		{
+			ShapeGlyphs(Scale);
+		}
+
+		const ESlateDrawEffect DrawEffects = ShouldBeEnabled(bParentEnabled) ? ESlateDrawEffect::None : ESlateDrawEffect::DisabledEffect;
+		const FLinearColor Tint = InWidgetStyle.GetColorAndOpacityTint() * ColorAndOpacity.GetColor(InWidgetStyle);
+		const FLinearColor OutlineTint = InWidgetStyle.GetColorAndOpacityTint() * Font.OutlineSettings.OutlineColor;
+		const float Height = AllottedGeometry.GetLocalSize().Y;
+
+		// Draw elements only reference the cached glyphs
+		float X = 0.0f;
+		for(const TCHAR Char : DisplayedText)
+		{
+			const FShapedGlyphSequenceRef Glyph = ShapedGlyphs[MDTimeText::GetGlyphIndex(Char)].ToSharedRef();
+			const float Width = Glyph->GetMeasuredWidth() / Scale;
+			const FPaintGeometry PaintGeometry = AllottedGeometry.ToPaintGeometry(FVector2f(Width, Height), FSlateLayoutTransform(FVector2f(X, 0.0f)));
+			FSlateDrawElement::MakeShapedText(OutDrawElements, LayerId, PaintGeometry, Glyph, DrawEffects, Tint, OutlineTint);
+			X += Width;
+		}
+		return LayerId;
+	}
+
+protected:
+
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override
+	{
+		const TSharedRef<FSlateFontMeasure> FontMeasure = FSlateApplication::Get().GetRenderer()->GetFontMeasureService();
+		return FontMeasure->Measure(MDTimeText::WidestTime, Font, LayoutScaleMultiplier) / LayoutScaleMultiplier;
+	}
+
+	// Only when font or DPI scale changes
+	void ShapeGlyphs(float Scale) const
+	{
+		const TSharedRef<FSlateFontCache> FontCache = FSlateApplication::Get().GetRenderer()->GetFontCache();
+		for(int32 Index = 0; Index < MDTimeText::NumGlyphs; ++Index)
+		{
+			ShapedGlyphs[Index] = FontCache->ShapeUnidirectionalText(MDTimeText::GlyphChars, Index, 1, Font, Scale, TextBiDi::ETextDirection::LeftToRight, ETextShapingMethod::KerningOnly);
+		}
+		ShapedFontScale = Scale;
+	}
+
+	FSlateFontInfo Font;
+
+	FSlateColor ColorAndOpacity;
+
+	FString DisplayedText;
+
+	int64 DisplayedMilliseconds = INDEX_NONE;
+
+	mutable FShapedGlyphSequencePtr ShapedGlyphs[MDTimeText::NumGlyphs];
+
+	// Scale ShapedGlyphs were shaped with, 0 if they need shaping
+	mutable float ShapedFontScale = 0.0f;
+};
+
+UMDTimeText::UMDTimeText(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	if(!IsRunningDedicatedServer())
+	{
+		Font = FCoreStyle::GetDefaultFontStyle("Regular", 24);
+	}
+	ColorAndOpacity = FLinearColor::White;
+	SetVisibilityInternal(ESlateVisibility::HitTestInvisible);
+}
+
+void UMDTimeText::SetTime(double Seconds, bool bEmptyWhenZero)
+{
+	Milliseconds = MDTimeText::ToMilliseconds(Seconds, bEmptyWhenZero);
+	if(MyTimeText.IsValid())
+	{
+		MyTimeText->SetMilliseconds(Milliseconds);
+	}
+}
+
+UMDTimeText* UMDTimeText::ReplaceTextBlock(UUserWidget& Owner, UTextBlock* TextBlock)
+{
+	UPanelWidget* Parent = TextBlock ? TextBlock->GetParent() : nullptr;
+	if(!Parent || !Owner.WidgetTree)
+	{
+		return nullptr;
+	}
+
+	auto* TimeText = Owner.WidgetTree->ConstructWidget<UMDTimeText>(UMDTimeText::StaticClass());
+	TimeText->Font = TextBlock->GetFont();
+	TimeText->ColorAndOpacity = TextBlock->GetColorAndOpacity();
+	// Time text takes over the text block's slot, so layout stays the same
+	Parent->ReplaceChild(TextBlock, TimeText);
+	return TimeText;
+}
+
+void UMDTimeText::SynchronizeProperties()
+{
+	Super::SynchronizeProperties();
+
+	if(MyTimeText.IsValid())
+	{
+		MyTimeText->SetFont(Font);
+		MyTimeText->SetColorAndOpacity(ColorAndOpacity);
+		MyTimeText->SetMilliseconds(Milliseconds);
+	}
+}
+
+void UMDTimeText::ReleaseSlateResources(bool bReleaseChildren)
+{
+	Super::ReleaseSlateResources(bReleaseChildren);
+
+	MyTimeText.Reset();
+}
+
+#if WITH_EDITOR
+const FText UMDTimeText::GetPaletteCategory()
+{
+	return LOCTEXT("MovementDemo", "Movement Demo");
+}
+#endif
+
+TSharedRef<SWidget> UMDTimeText::RebuildWidget()
+{
+	MyTimeText = SNew(SMDTimeText)
+		.Font(Font)
+		.ColorAndOpacity(ColorAndOpacity);
+
+	return MyTimeText.ToSharedRef();
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/Widget.h"
+#include "Fonts/SlateFontInfo.h"
+#include "Styling/SlateColor.h"
+#include "MDTimeText.generated.h"
+
+class SMDTimeText;
+class UTextBlock;
+class UUserWidget;
+
+/**
+ * MDTimeText shows a time in seconds with millisecond precision, for example 83.127.
+ * Unlike UTextBlock, it never creates FText, and updating or painting it doesn't allocate:
+ * 1. Digits are written into a string that is allocated once, when the widget is constructed.
+ * 2. Setting the same millisecond value again does nothing.
+ * 3. Desired size is measured from the widest possible time, so changing the value only invalidates paint, not layout.
+ * 4. Digits and the decimal point are shaped once per font and DPI scale. Painting draws the cached glyphs, instead of copying the string into a text draw element.
+ */
+UCLASS()
+class MOVEMENTDEMO_API UMDTimeText : public UWidget
+{
+	GENERATED_BODY()
+
+public:
+
+	UMDTimeText(const FObjectInitializer& ObjectInitializer);
+
+	// Negative time clears the text. So does zero, if bEmptyWhenZero is set.
+	void SetTime(double Seconds, bool bEmptyWhenZero = false);
+
+	// For widget blueprints that still have a text block instead of MDTimeText. Puts a time text with the same font and color in the text block's slot.
+	// Call before the widget is constructed, for example in NativeOnInitialized. Returns nullptr if text block is not in a panel.
+	static UMDTimeText* ReplaceTextBlock(UUserWidget& Owner, UTextBlock* TextBlock);
+
+	virtual void SynchronizeProperties() override;
+
+	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+
+#if WITH_EDITOR
+	virtual const FText GetPaletteCategory() override;
+#endif
+
+protected:
+
+	UPROPERTY(EditAnywhere, Category = "Appearance")
+	FSlateFontInfo Font;
+
+	UPROPERTY(EditAnywhere, Category = "Appearance")
+	FSlateColor ColorAndOpacity;
+
+	// Kept here, so the value survives rebuilding the slate widget
+	int64 Milliseconds = INDEX_NONE;
+
+	TSharedPtr<SMDTimeText> MyTimeText;
+
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+};
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MovementDemo/MDUIEventRouter.h"
+#include "MovementDemo/MDHUD.h"
+#include "MovementDemo/MDPlayerState.h"
+
+bool UMDUIEventRouter::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (!Super::ShouldCreateSubsystem(Outer))
+	{
+		return false;
+	}
+
+	const UWorld* World = CastChecked<UWorld>(Outer);
+	return World->GetNetMode() != NM_DedicatedServer; // no HUD on dedicated servers
+}
+
+void UMDUIEventRouter::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(PendingChanges.IsEmpty())
+	{
+		return;
+	}
+
+	// Keep changes until there is a HUD to show them
+	auto* HUD = LocalHUD.Get();
+	if(!HUD)
+	{
+		return;
+	}
+
+	for(const auto& Pair : PendingChanges)
+	{
+		if(auto* PlayerState = Pair.Key.ResolveObjectPtr())
+		{
+			HUD->RefreshPlayer(PlayerState, Pair.Value);
+		}
+	}
+
+	// Keeps the allocation for next time
+	PendingChanges.Reset();
+}
+
+TStatId UMDUIEventRouter::GetStatId() const
+{
+	return UObject::GetStatID();
+}
+
+void UMDUIEventRouter::RegisterLocalHUD(AMDHUD* HUD)
+{
+	// Split screen would have more than one, first one is used
+	if(!LocalHUD.IsValid())
+	{
+		LocalHUD = HUD;
+	}
+}
+
+void UMDUIEventRouter::UnregisterLocalHUD(AMDHUD* HUD)
+{
+	if(LocalHUD.Get() == HUD)
+	{
+		LocalHUD.Reset();
+	}
+}
+
+void UMDUIEventRouter::NotifyPlayerChanged(AMDPlayerState* PlayerState, EMDPlayerUIChange Changes)
+{
+	PendingChanges.FindOrAdd(PlayerState) |= Changes;
+}
+
+void UMDUIEventRouter::NotifyPlayerRemoved(AMDPlayerState* PlayerState)
+{
+	PendingChanges.Remove(PlayerState);
+
+	if(auto* HUD = LocalHUD.Get())
+	{
+		HUD->RemoveWidgetForRemotePlayer(PlayerState);
+	}
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "MDUIEventRouter.generated.h"
+
+class AMDHUD;
+class AMDPlayerState;
+
+// What changed on a PlayerState since the HUD was last refreshed
+enum class EMDPlayerUIChange : uint8
+{
+	None = 0,
+	Name = 1 << 0,
+	BestTime = 1 << 1,
+	LastTime = 1 << 2,
+	Wins = 1 << 3,
+	ReachedGoal = 1 << 4,
+	All = Name | BestTime | LastTime | Wins | ReachedGoal,
+};
+ENUM_CLASS_FLAGS(EMDPlayerUIChange)
+
+/**
+ * Client side WorldSubsystem that sits between PlayerStates and the local AMDHUD. Not created on dedicated servers, which have no HUD.
+ * 1. AMDHUD registers itself on BeginPlay, so finding the local HUD doesn't iterate player controllers.
+ * 2. PlayerStates report what changed with NotifyPlayerChanged. Changes are merged per player and
+ *    flushed to the HUD once per frame, so a burst of replicated properties (e.g. at match end) costs one UI refresh per player.
+ * 3. Removal is not deferred, PlayerState is going away.
+ */
+UCLASS()
+class MOVEMENTDEMO_API UMDUIEventRouter : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	void RegisterLocalHUD(AMDHUD* HUD);
+
+	void UnregisterLocalHUD(AMDHUD* HUD);
+
+	AMDHUD* GetLocalHUD() const { return LocalHUD.Get(); }
+
+	void NotifyPlayerChanged(AMDPlayerState* PlayerState, EMDPlayerUIChange Changes);
+
+	// Drops pending changes and removes player's widgets right away
+	void NotifyPlayerRemoved(AMDPlayerState* PlayerState);
+
+protected:
+
+	TWeakObjectPtr<AMDHUD> LocalHUD;
+
+	TMap<TObjectKey<AMDPlayerState>, EMDPlayerUIChange> PendingChanges;
+};
@@ -0,0 +1,23 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class MovementDemoServerTarget : TargetRules
+{
+	public MovementDemoServerTarget( TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.Latest;
+		IncludeOrderVersion = EngineIncludeOrderVersion.Latest;
+		ExtraModuleNames.Add("MovementDemo");
+
+		// Iris is compiled in, but only used if enabled with net.Iris.UseIrisReplication=1 or -UseIrisReplication=1
+		bUseIris = true;
+
+		// Startup time and memory are logged when the first match starts, keep that in shipping servers too.
+		// Logging in shipping changes engine modules, so the target can't share the installed build environment.
+		BuildEnvironment = TargetBuildEnvironment.Unique;
+		bUseLoggingInShipping = true;
+	}
+}